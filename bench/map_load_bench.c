@@ -0,0 +1,136 @@
+// stalker-c/bench/map_load_bench.c
+// Compares loading the same level from the text format and from the mapped
+// binary format
+//
+// Build (from the repository root):
+//   cc -O2 -o map_load_bench bench/map_load_bench.c map/*.c
+//      helper/vector.c helper/rng.c helper/profiler.c helper/trace.c $(pkg-config --cflags --libs sdl3) -lm
+// Usage:
+//   ./map_load_bench [runs_per_size]
+// The generated levels are written to the working directory and removed after
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../map/map.h"
+#include "../map/map_binary.h"
+
+static unsigned int bench_seed = 12345;
+
+static int bench_rand(void) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return (int)((bench_seed >> 16) & 0x7fff);
+}
+
+/// Writes a level.txt style file with walls on the border, scattered pillars,
+/// a player, a couple of enemies and one NPC
+static bool write_text_level(const char* filename, int size) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return false;
+
+    fprintf(file, "%d,%d\n", size, size);
+    fprintf(file, "enemy:\nE1=(10,10,200,60,40,1.0,1.5,2.0)\nE2=(10,10,300,80,40,1.0,1.5,2.0)\n");
+    fprintf(file, "npc:\ndefine:N1,10,10\ndialogue:N1,\"Hello there\"\n");
+    fprintf(file, "map:\n");
+
+    char* row = (char*)malloc(size + 2);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+            row[x] = (border || bench_rand() % 100 < 12) ? '1' : '0';
+        }
+        if (y == size / 2) {
+            row[size / 2] = 'P';
+            row[size / 4] = 'E';
+            row[size / 4 + 1] = '1';
+            row[size / 3] = 'N';
+            row[size / 3 + 1] = '1';
+        }
+        row[size] = '\n';
+        row[size + 1] = '\0';
+        fputs(row, file);
+    }
+    free(row);
+    return fclose(file) == 0;
+}
+
+// Loads the level and touches every tile, so a mapped file is paged in and
+// both formats are measured up to the point the game can use the map
+static double time_load(const char* filename, int runs, long* checksum) {
+    const double frequency = (double)SDL_GetPerformanceFrequency();
+    double best = 0.0;
+    for (int r = 0; r < runs; r++) {
+        Map map;
+        memset(&map, 0, sizeof(map));
+        Uint64 begin = SDL_GetPerformanceCounter();
+        map_load_from_file(&map, filename);
+        long walls = 0;
+        for (int y = 0; y < map.height; y++) {
+            for (int x = 0; x < map.width; x++) {
+                walls += map.cost_field[y * map.width + x] == 0;
+            }
+        }
+        double seconds = (SDL_GetPerformanceCounter() - begin) / frequency;
+        if (r == 0 || seconds < best) best = seconds;
+        *checksum = walls;
+        map_destroy(&map);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+    if (runs <= 0) runs = 5;
+
+    const int sizes[] = { 1024, 4096 };
+
+    printf("%-10s %12s %12s %12s %12s %9s\n", "map", "txt bytes", "bin bytes", "txt ms", "bin ms", "speedup");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        char text_path[64];
+        char binary_path[64];
+        snprintf(text_path, sizeof(text_path), "bench_level_%d.txt", sizes[s]);
+        snprintf(binary_path, sizeof(binary_path), "bench_level_%d.bin", sizes[s]);
+
+        if (!write_text_level(text_path, sizes[s])) {
+            printf("Error: Could not write %s\n", text_path);
+            return 1;
+        }
+        Map map;
+        memset(&map, 0, sizeof(map));
+        map_load_from_file(&map, text_path);
+        bool saved = map_save_binary(&map, binary_path);
+        map_destroy(&map);
+        if (!saved) {
+            remove(text_path);
+            return 1;
+        }
+
+        long text_walls = 0;
+        long binary_walls = 0;
+        double text_seconds = time_load(text_path, runs, &text_walls);
+        double binary_seconds = time_load(binary_path, runs, &binary_walls);
+        if (text_walls != binary_walls) {
+            printf("Warning: text level has %ld walls, binary level has %ld\n", text_walls, binary_walls);
+        }
+
+        FILE* file = fopen(text_path, "rb");
+        fseek(file, 0, SEEK_END);
+        long text_bytes = ftell(file);
+        fclose(file);
+        file = fopen(binary_path, "rb");
+        fseek(file, 0, SEEK_END);
+        long binary_bytes = ftell(file);
+        fclose(file);
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", sizes[s], sizes[s]);
+        printf("%-10s %12ld %12ld %12.2f %12.2f %8.1fx\n", label, text_bytes, binary_bytes,
+               text_seconds * 1000.0, binary_seconds * 1000.0, text_seconds / binary_seconds);
+
+        remove(text_path);
+        remove(binary_path);
+    }
+    return 0;
+}
@@ -0,0 +1,459 @@
+// stalker-c/bench/micro_bench.c
+// Per operation latency of the map and pathfinding code on generated maps from
+// 64x64 to 4096x4096, meant to be run on every commit to catch regressions
+//
+// Build (from the repository root):
+//   cc -O2 -o micro_bench bench/micro_bench.c map/*.c helper/pathfinding.c
+//      helper/hpa.c helper/vector.c helper/rng.c helper/profiler.c helper/trace.c
+//      $(pkg-config --cflags --libs sdl3) -lm
+// Usage:
+//   ./micro_bench [--samples N] [--max-size N] [--out file]
+// The results go to file (micro_bench.json by default) as
+//   {"benchmarks":[{"op":"path_short","map":64,"samples":200,"calls_per_sample":1,
+//     "min_us":..,"p50_us":..,"p90_us":..,"p99_us":..,"max_us":..,"mean_us":..}, ...]}
+// Every sample times calls_per_sample calls and is divided back to one call,
+// the ops too quick for the timer are batched that way. Path ops also report
+// how many calls found a path as "found", line of sight ops how many saw their
+// target. A summary table is printed to stdout.
+// Before timing anything a few line of sight cases with a known answer are
+// checked, a wrong answer fails the run.
+// The generated levels are written to the working directory and removed after
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../map/map.h"
+#include "../map/map_binary.h"
+#include "../helper/pathfinding.h"
+#include "../helper/hpa.h"
+#include "../helper/rng.h"
+
+#define SHORT_QUERY_TILES 16     // Short queries end within this many tiles of the start
+#define LOS_BATCH 32             // Line of sight calls per sample
+#define RANDOM_TILE_BATCH 32     // map_get_random_walkable_tile calls per sample
+#define OP_TIME_BUDGET_NS 2000000000ULL // An op stops sampling after this, keeping at least MIN_SAMPLES
+#define MIN_SAMPLES 5
+
+typedef struct {
+    double* samples_us; // One entry per sample, already divided per call
+    int count;
+    int capacity;
+    int calls_per_sample;
+    int found;          // Calls that found a path or had line of sight, -1 for other ops
+    Uint64 started_ns;
+} OpTimer;
+
+static FILE* results = NULL;
+static bool first_result = true;
+
+// Same generator as the other benches so every run sees the same maps
+static unsigned int bench_seed = 12345u;
+static int bench_rand(void) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return (int)((bench_seed >> 16) & 0x7fff);
+}
+
+// bench_rand only has 15 bits, large maps need two draws per coordinate
+static int bench_rand_below(int limit) {
+    return (int)((((unsigned int)bench_rand() << 15) | (unsigned int)bench_rand()) % (unsigned int)limit);
+}
+
+/// Walled map with scattered pillars and a few long walls, see
+/// pathfinding_bench. The bottom right corner tile is floor sealed in by walls
+/// so there is always a goal no search can reach
+static void generate_map(Map* map, int size) {
+    memset(map, 0, sizeof(*map));
+    map_alloc_tiles(map, size, size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+            map_set_tile(map, x, y, (border || bench_rand() % 100 < 12) ? TILE_WALL : TILE_FLOOR);
+        }
+    }
+    for (int w = 0; w < (size * size) / 512; w++) {
+        int x = bench_rand_below(size);
+        int y = bench_rand_below(size);
+        int length = 4 + bench_rand() % 24;
+        bool horizontal = bench_rand() % 2;
+        for (int i = 0; i < length; i++) {
+            int wx = horizontal ? x + i : x;
+            int wy = horizontal ? y : y + i;
+            if (wx < size && wy < size) map_set_tile(map, wx, wy, TILE_WALL);
+        }
+    }
+    map_set_tile(map, size - 2, size - 2, TILE_FLOOR);
+    map_set_tile(map, size - 3, size - 2, TILE_WALL);
+    map_set_tile(map, size - 2, size - 3, TILE_WALL);
+    map_set_tile(map, size - 3, size - 3, TILE_WALL);
+
+    map->cost_config.floor_cost = MAP_DEFAULT_FLOOR_COST;
+    map->cost_config.wall_penalty = MAP_DEFAULT_WALL_PENALTY;
+    map_build_cost_field(map);
+}
+
+static bool write_text_level(const Map* map, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (!file) return false;
+
+    fprintf(file, "%d,%d\nmap:\n", map->width, map->height);
+    char* row = (char*)malloc(map->width + 2);
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            row[x] = map_is_wall(map, x, y) ? '1' : '0';
+        }
+        row[map->width] = '\n';
+        row[map->width + 1] = '\0';
+        fputs(row, file);
+    }
+    free(row);
+    return fclose(file) == 0;
+}
+
+static Vector2f tile_position(int x, int y) {
+    return (Vector2f){ x * TILE_SIZE, y * TILE_SIZE };
+}
+
+static void random_floor(const Map* map, int* x, int* y) {
+    do {
+        *x = bench_rand_below(map->width);
+        *y = bench_rand_below(map->height);
+    } while (map_is_wall(map, *x, *y) || (*x == map->width - 2 && *y == map->height - 2));
+}
+
+// -----------------------------------------------------------------------------
+// Timing
+// -----------------------------------------------------------------------------
+
+static void op_begin(OpTimer* timer, int max_samples, int calls_per_sample, bool counts_found) {
+    timer->samples_us = (double*)malloc(max_samples * sizeof(double));
+    timer->count = 0;
+    timer->capacity = max_samples;
+    timer->calls_per_sample = calls_per_sample;
+    timer->found = counts_found ? 0 : -1;
+    timer->started_ns = SDL_GetTicksNS();
+}
+
+// Whether another sample should be taken
+static bool op_running(const OpTimer* timer) {
+    if (timer->count >= timer->capacity) return false;
+    return timer->count < MIN_SAMPLES || SDL_GetTicksNS() - timer->started_ns < OP_TIME_BUDGET_NS;
+}
+
+static void op_sample(OpTimer* timer, Uint64 begin, Uint64 end) {
+    const double frequency = (double)SDL_GetPerformanceFrequency();
+    timer->samples_us[timer->count++] = (end - begin) * 1e6 / frequency / timer->calls_per_sample;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted samples
+static double percentile(const double* sorted, int count, int p) {
+    int rank = (count * p + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/// Sorts the samples, writes the op to the results file and the table
+static void op_end(OpTimer* timer, const char* op, int size) {
+    if (timer->count == 0) {
+        free(timer->samples_us);
+        return;
+    }
+    qsort(timer->samples_us, timer->count, sizeof(double), compare_doubles);
+    double sum = 0.0;
+    for (int i = 0; i < timer->count; i++) sum += timer->samples_us[i];
+
+    const double* s = timer->samples_us;
+    const int n = timer->count;
+    fprintf(results, "%s    {\"op\":\"%s\",\"map\":%d,\"samples\":%d,\"calls_per_sample\":%d,"
+            "\"min_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"mean_us\":%.3f",
+            first_result ? "" : ",\n", op, size, n, timer->calls_per_sample,
+            s[0], percentile(s, n, 50), percentile(s, n, 90), percentile(s, n, 99), s[n - 1], sum / n);
+    if (timer->found >= 0) fprintf(results, ",\"found\":%d", timer->found);
+    fprintf(results, "}");
+    first_result = false;
+
+    printf("%-18s %6d %8d %12.3f %12.3f %12.3f %12.3f\n", op, size, n,
+           percentile(s, n, 50), percentile(s, n, 90), percentile(s, n, 99), s[n - 1]);
+    fflush(stdout);
+    free(timer->samples_us);
+}
+
+// -----------------------------------------------------------------------------
+// Ops
+// -----------------------------------------------------------------------------
+
+typedef enum {
+    QUERY_SHORT,       // Goal within SHORT_QUERY_TILES, always the flat search
+    QUERY_LONG,        // Goal at least half the map away, hierarchical when it can be
+    QUERY_UNREACHABLE, // Goal in the sealed corner, every search runs dry
+} QueryKind;
+
+static void bench_paths(const Map* map, QueryKind kind, const char* op, int samples) {
+    const int size = map->width;
+    OpTimer timer;
+    op_begin(&timer, samples, 1, true);
+
+    while (op_running(&timer)) {
+        int sx, sy, ex, ey;
+        random_floor(map, &sx, &sy);
+        if (kind == QUERY_UNREACHABLE) {
+            ex = size - 2;
+            ey = size - 2;
+        } else if (kind == QUERY_SHORT) {
+            do {
+                ex = sx + bench_rand() % (SHORT_QUERY_TILES * 2 + 1) - SHORT_QUERY_TILES;
+                ey = sy + bench_rand() % (SHORT_QUERY_TILES * 2 + 1) - SHORT_QUERY_TILES;
+            } while (!map_in_bounds(map, ex, ey) || map_is_wall(map, ex, ey) || (ex == size - 2 && ey == size - 2));
+        } else {
+            do {
+                random_floor(map, &ex, &ey);
+            } while (abs(ex - sx) + abs(ey - sy) < size / 2);
+        }
+
+        Uint64 begin = SDL_GetPerformanceCounter();
+        Path* path = pathfinding_find_path(map, tile_position(sx, sy), tile_position(ex, ey));
+        Uint64 end = SDL_GetPerformanceCounter();
+        op_sample(&timer, begin, end);
+        if (path) timer.found++;
+        path_destroy(path);
+    }
+    op_end(&timer, op, size);
+}
+
+/// One PATH_SEARCH_SLICE step of a flat search toward the sealed corner, from
+/// close enough that the hierarchy isn't used. This is the most a path worker
+/// does before it looks at the budget again, path_unreachable is what the same
+/// search costs run to the end
+static void bench_path_step(const Map* map, int samples) {
+    const int size = map->width;
+    const int reach = SDL_min(HPA_MIN_QUERY_DISTANCE / 2, size - 2);
+    OpTimer timer;
+    op_begin(&timer, samples, 1, false);
+
+    while (op_running(&timer)) {
+        int sx, sy;
+        do {
+            sx = size - 2 - bench_rand_below(reach);
+            sy = size - 2 - bench_rand_below(reach);
+        } while (map_is_wall(map, sx, sy) || (sx == size - 2 && sy == size - 2));
+
+        pathfinding_search_begin(map->pathfinding, map, tile_position(sx, sy), tile_position(size - 2, size - 2));
+        Uint64 begin = SDL_GetPerformanceCounter();
+        pathfinding_search_step(map->pathfinding, map, PATH_SEARCH_SLICE, NULL);
+        Uint64 end = SDL_GetPerformanceCounter();
+        op_sample(&timer, begin, end);
+    }
+    op_end(&timer, "path_step", size);
+}
+
+/// Rays of a fixed length in tiles from random floor tiles, in random
+/// directions and clamped to the map. Most of the long ones end on a wall
+/// well before their length, the same as in the game
+static void bench_line_of_sight(const Map* map, int length, int samples) {
+    Vector2f starts[LOS_BATCH];
+    Vector2f ends[LOS_BATCH];
+    OpTimer timer;
+    op_begin(&timer, samples, LOS_BATCH, true);
+
+    while (op_running(&timer)) {
+        for (int i = 0; i < LOS_BATCH; i++) {
+            int sx, sy;
+            random_floor(map, &sx, &sy);
+            float angle = (bench_rand() % 3600) * (SDL_PI_F / 1800.0f);
+            float ex = SDL_clamp(sx + SDL_cosf(angle) * length, 1.0f, map->width - 2.0f);
+            float ey = SDL_clamp(sy + SDL_sinf(angle) * length, 1.0f, map->height - 2.0f);
+            starts[i] = (Vector2f){ (sx + 0.5f) * TILE_SIZE, (sy + 0.5f) * TILE_SIZE };
+            ends[i] = (Vector2f){ (ex + 0.5f) * TILE_SIZE, (ey + 0.5f) * TILE_SIZE };
+        }
+
+        int visible = 0;
+        Uint64 begin = SDL_GetPerformanceCounter();
+        for (int i = 0; i < LOS_BATCH; i++) {
+            visible += map_has_line_of_sight(map, starts[i], ends[i]);
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+        op_sample(&timer, begin, end);
+        timer.found += visible;
+    }
+
+    char op[32];
+    snprintf(op, sizeof(op), "los_%d", length);
+    op_end(&timer, op, map->width);
+}
+
+/// Segments that end exactly on a tile corner, every tile but the two end
+/// tiles is a wall. The walk has to stop on the end tile instead of cutting
+/// past the corner into a wall beyond it
+static bool check_line_of_sight_corners(void) {
+    static const struct {
+        float start_x, start_y, end_x, end_y; // Tiles
+        bool visible;
+    } cases[] = {
+        { 0.5f, 1.5f, 1.0f, 1.0f, true },  // One tile right and up
+        { 1.5f, 0.5f, 1.0f, 1.0f, true },  // One tile left and down
+        { 0.5f, 0.5f, 1.0f, 1.0f, false }, // Through the corner, walls on both sides
+    };
+
+    Map map;
+    memset(&map, 0, sizeof(map));
+    if (!map_alloc_tiles(&map, 4, 4)) {
+        printf("Error: Could not allocate the line of sight check map\n");
+        return false;
+    }
+
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const int start_x = (int)cases[i].start_x, start_y = (int)cases[i].start_y;
+        const int end_x = (int)cases[i].end_x, end_y = (int)cases[i].end_y;
+        for (int y = 0; y < map.height; y++) {
+            for (int x = 0; x < map.width; x++) {
+                bool open = (x == start_x && y == start_y) || (x == end_x && y == end_y);
+                map_set_tile(&map, x, y, open ? TILE_FLOOR : TILE_WALL);
+            }
+        }
+
+        Vector2f start = { cases[i].start_x * TILE_SIZE, cases[i].start_y * TILE_SIZE };
+        Vector2f end = { cases[i].end_x * TILE_SIZE, cases[i].end_y * TILE_SIZE };
+        if (map_has_line_of_sight(&map, start, end) != cases[i].visible) {
+            printf("Error: Line of sight from tile (%.1f, %.1f) to (%.1f, %.1f) should be %s\n",
+                   cases[i].start_x, cases[i].start_y, cases[i].end_x, cases[i].end_y,
+                   cases[i].visible ? "clear" : "blocked");
+            passed = false;
+        }
+    }
+    map_destroy(&map);
+    return passed;
+}
+
+static void bench_random_walkable_tile(const Map* map, int samples) {
+    Rng rng;
+    rng_seed(&rng, 1);
+    OpTimer timer;
+    op_begin(&timer, samples, RANDOM_TILE_BATCH, false);
+
+    volatile float sink = 0.0f;
+    while (op_running(&timer)) {
+        Uint64 begin = SDL_GetPerformanceCounter();
+        for (int i = 0; i < RANDOM_TILE_BATCH; i++) {
+            sink += map_get_random_walkable_tile(map, &rng).x;
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+        op_sample(&timer, begin, end);
+    }
+    op_end(&timer, "random_tile", map->width);
+}
+
+// Load time up to the point the game can use the map, every tile of the cost
+// field is touched so a mapped binary level is paged in as well
+static void bench_load(const char* filename, const char* op, int size, int samples) {
+    OpTimer timer;
+    op_begin(&timer, samples, 1, false);
+
+    volatile long walls = 0;
+    while (op_running(&timer)) {
+        Map map;
+        memset(&map, 0, sizeof(map));
+        Uint64 begin = SDL_GetPerformanceCounter();
+        map_load_from_file(&map, filename);
+        for (int i = 0; i < map.width * map.height; i++) {
+            walls += map.cost_field[i] == 0;
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+        op_sample(&timer, begin, end);
+        map_destroy(&map);
+    }
+    op_end(&timer, op, size);
+}
+
+static void usage(const char* program) {
+    printf("usage: %s [--samples N] [--max-size N] [--out file]\n", program);
+}
+
+int main(int argc, char** argv) {
+    int samples = 200;
+    int max_size = 4096;
+    const char* out_path = "micro_bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(argv[i], "--samples") == 0) {
+            samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-size") == 0) {
+            max_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (samples < MIN_SAMPLES) samples = MIN_SAMPLES;
+    if (!check_line_of_sight_corners()) return 1;
+
+    results = fopen(out_path, "w");
+    if (!results) {
+        printf("Error: Could not create %s\n", out_path);
+        return 1;
+    }
+    fprintf(results, "{\"benchmarks\":[\n");
+
+    const int sizes[] = { 64, 256, 1024, 4096 };
+    const int ray_lengths[] = { 8, 64, 512 };
+
+    printf("%-18s %6s %8s %12s %12s %12s %12s\n", "op", "map", "samples", "p50 us", "p90 us", "p99 us", "max us");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= max_size; s++) {
+        const int size = sizes[s];
+        Map map;
+        generate_map(&map, size);
+
+        // Set up the way game_load does it
+        map.hierarchy = hpa_build(&map, HPA_CLUSTER_SIZE);
+        map.pathfinding = pathfinding_context_create(&map);
+        if (!map.hierarchy || !map.pathfinding) {
+            printf("Error: Could not set up pathfinding for a %dx%d map\n", size, size);
+            return 1;
+        }
+
+        bench_paths(&map, QUERY_SHORT, "path_short", samples);
+        bench_paths(&map, QUERY_LONG, "path_long", samples);
+        bench_paths(&map, QUERY_UNREACHABLE, "path_unreachable", samples);
+        bench_path_step(&map, samples);
+        for (size_t r = 0; r < sizeof(ray_lengths) / sizeof(ray_lengths[0]); r++) {
+            if (ray_lengths[r] < size) bench_line_of_sight(&map, ray_lengths[r], samples);
+        }
+        bench_random_walkable_tile(&map, samples);
+
+        char text_path[64];
+        char binary_path[64];
+        snprintf(text_path, sizeof(text_path), "micro_bench_%d.txt", size);
+        snprintf(binary_path, sizeof(binary_path), "micro_bench_%d.bin", size);
+        if (write_text_level(&map, text_path) && map_save_binary(&map, binary_path)) {
+            bench_load(text_path, "load_text", size, samples);
+            bench_load(binary_path, "load_binary", size, samples);
+        } else {
+            printf("Error: Could not write the %dx%d levels\n", size, size);
+        }
+        remove(text_path);
+        remove(binary_path);
+
+        pathfinding_context_destroy(map.pathfinding);
+        map.pathfinding = NULL;
+        hpa_destroy(map.hierarchy);
+        map.hierarchy = NULL;
+        map_destroy(&map);
+    }
+
+    fprintf(results, "\n]}\n");
+    fclose(results);
+    printf("Results written to %s\n", out_path);
+    return 0;
+}
@@ -0,0 +1,325 @@
+// stalker-c/bench/pathfinding_bench.c
+// Compares the arena based A* against the old malloc-per-query version, and
+// the hierarchical (HPA*) mode against both
+//
+// Build (from the repository root):
+//   cc -O2 -o pathfinding_bench bench/pathfinding_bench.c helper/pathfinding.c
+//      helper/hpa.c helper/vector.c helper/rng.c helper/profiler.c helper/trace.c map/*.c
+//      $(pkg-config --cflags --libs sdl3) -lm
+// Usage:
+//   ./pathfinding_bench [queries_per_size]
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../map/map.h"
+#include "../helper/pathfinding.h"
+#include "../helper/hpa.h"
+
+// -----------------------------------------------------------------------------
+// Reference implementation, this is pathfinding_find_path as it was before the
+// search arena, kept here so the numbers are measured against the real thing
+// The only change is that the path is clamped to MAX_PATH_LENGTH, the original
+// wrote past the end of Path.points on long routes
+// -----------------------------------------------------------------------------
+
+typedef struct LegacyNode {
+    int x, y;
+    float g_score;
+    float f_score;
+    struct LegacyNode* parent;
+    bool in_open_set;
+} LegacyNode;
+
+typedef struct {
+    LegacyNode** nodes;
+    int count;
+    int capacity;
+} LegacyQueue;
+
+static void legacy_swap(LegacyNode** a, LegacyNode** b) {
+    LegacyNode* temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+static void legacy_heapify_up(LegacyQueue* pq, int index) {
+    while (index > 0) {
+        int parent_index = (index - 1) / 2;
+        if (pq->nodes[index]->f_score < pq->nodes[parent_index]->f_score) {
+            legacy_swap(&pq->nodes[index], &pq->nodes[parent_index]);
+            index = parent_index;
+        } else {
+            break;
+        }
+    }
+}
+
+static void legacy_heapify_down(LegacyQueue* pq, int index) {
+    while (1) {
+        int left = 2 * index + 1;
+        int right = 2 * index + 2;
+        int smallest = index;
+        if (left < pq->count && pq->nodes[left]->f_score < pq->nodes[smallest]->f_score) smallest = left;
+        if (right < pq->count && pq->nodes[right]->f_score < pq->nodes[smallest]->f_score) smallest = right;
+        if (smallest == index) break;
+        legacy_swap(&pq->nodes[index], &pq->nodes[smallest]);
+        index = smallest;
+    }
+}
+
+static void legacy_push(LegacyQueue* pq, LegacyNode* node) {
+    if (pq->count >= pq->capacity) return;
+    pq->nodes[pq->count] = node;
+    node->in_open_set = true;
+    legacy_heapify_up(pq, pq->count);
+    pq->count++;
+}
+
+static LegacyNode* legacy_pop(LegacyQueue* pq) {
+    if (pq->count == 0) return NULL;
+    LegacyNode* top = pq->nodes[0];
+    pq->nodes[0] = pq->nodes[pq->count - 1];
+    pq->count--;
+    legacy_heapify_down(pq, 0);
+    top->in_open_set = false;
+    return top;
+}
+
+static void legacy_free_nodes(const Map* map, LegacyNode*** all_nodes, LegacyQueue* open_set) {
+    free(open_set->nodes);
+    free(open_set);
+    for (int y = 0; y < map->height; y++) {
+        for (int x = 0; x < map->width; x++) {
+            if (all_nodes[y][x]) free(all_nodes[y][x]);
+        }
+        free(all_nodes[y]);
+    }
+    free(all_nodes);
+}
+
+static Path* legacy_find_path(const Map* map, Vector2f start_pos, Vector2f end_pos) {
+    int start_x = start_pos.x / TILE_SIZE;
+    int start_y = start_pos.y / TILE_SIZE;
+    int end_x = end_pos.x / TILE_SIZE;
+    int end_y = end_pos.y / TILE_SIZE;
+
+    if (end_y < 0 || end_y >= map->height || end_x < 0 || end_x >= map->width || map_is_wall(map, end_x, end_y)) {
+        return NULL;
+    }
+    if (start_y < 0 || start_y >= map->height || start_x < 0 || start_x >= map->width) {
+        return NULL;
+    }
+
+    LegacyNode*** all_nodes = (LegacyNode***)malloc(map->height * sizeof(LegacyNode**));
+    for (int i = 0; i < map->height; i++) {
+        all_nodes[i] = (LegacyNode**)malloc(map->width * sizeof(LegacyNode*));
+        memset(all_nodes[i], 0, map->width * sizeof(LegacyNode*));
+    }
+
+    LegacyQueue* open_set = (LegacyQueue*)malloc(sizeof(LegacyQueue));
+    open_set->capacity = map->width * map->height;
+    open_set->nodes = (LegacyNode**)malloc(sizeof(LegacyNode*) * open_set->capacity);
+    open_set->count = 0;
+
+    LegacyNode* start_node = (LegacyNode*)malloc(sizeof(LegacyNode));
+    start_node->x = start_x;
+    start_node->y = start_y;
+    start_node->g_score = 0;
+    start_node->f_score = abs(start_x - end_x) + abs(start_y - end_y);
+    start_node->parent = NULL;
+    start_node->in_open_set = false;
+    all_nodes[start_y][start_x] = start_node;
+    legacy_push(open_set, start_node);
+
+    while (open_set->count > 0) {
+        LegacyNode* current = legacy_pop(open_set);
+
+        if (current->x == end_x && current->y == end_y) {
+            int length = 0;
+            for (LegacyNode* temp = current; temp != NULL; temp = temp->parent) length++;
+
+            Path* path = (Path*)malloc(sizeof(Path));
+            path->count = 0;
+            LegacyNode* temp = current;
+            for (int skip = length - MAX_PATH_LENGTH; skip > 0; skip--) temp = temp->parent;
+            while (temp != NULL) {
+                path->points[path->count++] = (Vector2f){ temp->x * TILE_SIZE, temp->y * TILE_SIZE };
+                temp = temp->parent;
+            }
+            for (int i = 0; i < path->count / 2; i++) {
+                Vector2f temp_point = path->points[i];
+                path->points[i] = path->points[path->count - i - 1];
+                path->points[path->count - i - 1] = temp_point;
+            }
+            path->current_node = 0;
+            legacy_free_nodes(map, all_nodes, open_set);
+            return path;
+        }
+
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if (abs(dx) == abs(dy)) continue;
+
+                int neighbor_x = current->x + dx;
+                int neighbor_y = current->y + dy;
+
+                if (neighbor_x < 0 || neighbor_x >= map->width || neighbor_y < 0 || neighbor_y >= map->height || map_is_wall(map, neighbor_x, neighbor_y)) {
+                    continue;
+                }
+
+                float cost = 1.0f;
+                for (int nx = -1; nx <= 1; nx++) {
+                    for (int ny = -1; ny <= 1; ny++) {
+                        if (nx == 0 && ny == 0) continue;
+                        int check_x = neighbor_x + nx;
+                        int check_y = neighbor_y + ny;
+                        if (check_x >= 0 && check_x < map->width && check_y >= 0 && check_y < map->height) {
+                            if (map_is_wall(map, check_x, check_y)) cost += 15.0f;
+                        }
+                    }
+                }
+
+                float tentative_g_score = current->g_score + cost;
+                LegacyNode* neighbor = all_nodes[neighbor_y][neighbor_x];
+
+                if (!neighbor || tentative_g_score < neighbor->g_score) {
+                    if (!neighbor) {
+                        neighbor = (LegacyNode*)malloc(sizeof(LegacyNode));
+                        all_nodes[neighbor_y][neighbor_x] = neighbor;
+                        neighbor->in_open_set = false;
+                    }
+                    neighbor->x = neighbor_x;
+                    neighbor->y = neighbor_y;
+                    neighbor->parent = current;
+                    neighbor->g_score = tentative_g_score;
+                    neighbor->f_score = neighbor->g_score + abs(neighbor_x - end_x) + abs(neighbor_y - end_y);
+                    if (!neighbor->in_open_set) legacy_push(open_set, neighbor);
+                }
+            }
+        }
+    }
+
+    legacy_free_nodes(map, all_nodes, open_set);
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Benchmark
+// -----------------------------------------------------------------------------
+
+// Small deterministic generator so both implementations see the same queries
+static unsigned int bench_seed = 12345u;
+static int bench_rand(void) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return (int)((bench_seed >> 16) & 0x7fff);
+}
+
+/// Builds a walled map with scattered pillars and a few long walls, which
+/// gives a mix of open areas and detours similar to hand made levels
+static void generate_map(Map* map, int width, int height) {
+    memset(map, 0, sizeof(*map));
+    map_alloc_tiles(map, width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            bool border = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+            map_set_tile(map, x, y, (border || bench_rand() % 100 < 12) ? TILE_WALL : TILE_FLOOR);
+        }
+    }
+    for (int w = 0; w < (width * height) / 512; w++) {
+        int x = bench_rand() % width;
+        int y = bench_rand() % height;
+        int length = 4 + bench_rand() % 24;
+        bool horizontal = bench_rand() % 2;
+        for (int i = 0; i < length; i++) {
+            int wx = horizontal ? x + i : x;
+            int wy = horizontal ? y : y + i;
+            if (wx < width && wy < height) map_set_tile(map, wx, wy, TILE_WALL);
+        }
+    }
+    map->cost_config.floor_cost = MAP_DEFAULT_FLOOR_COST;
+    map->cost_config.wall_penalty = MAP_DEFAULT_WALL_PENALTY;
+    map_build_cost_field(map);
+}
+
+static Vector2f random_floor(const Map* map) {
+    int x, y;
+    do {
+        x = bench_rand() % map->width;
+        y = bench_rand() % map->height;
+    } while (map_is_wall(map, x, y));
+    return (Vector2f){ x * TILE_SIZE, y * TILE_SIZE };
+}
+
+int main(int argc, char** argv) {
+    int queries = argc > 1 ? atoi(argv[1]) : 200;
+    if (queries <= 0) queries = 200;
+
+    const int sizes[] = { 64, 128, 256, 512, 1024 };
+    const double frequency = (double)SDL_GetPerformanceFrequency();
+
+    printf("%-10s %-8s %14s %14s %9s %14s %9s\n", "map", "queries", "legacy q/s", "arena q/s", "speedup", "hpa q/s", "speedup");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        Map map;
+        generate_map(&map, sizes[s], sizes[s]);
+        map.pathfinding = pathfinding_context_create(&map);
+
+        Vector2f* starts = (Vector2f*)malloc(queries * sizeof(Vector2f));
+        Vector2f* ends = (Vector2f*)malloc(queries * sizeof(Vector2f));
+        for (int q = 0; q < queries; q++) {
+            starts[q] = random_floor(&map);
+            ends[q] = random_floor(&map);
+        }
+
+        int legacy_found = 0;
+        Uint64 begin = SDL_GetPerformanceCounter();
+        for (int q = 0; q < queries; q++) {
+            Path* path = legacy_find_path(&map, starts[q], ends[q]);
+            if (path) legacy_found++;
+            path_destroy(path);
+        }
+        double legacy_seconds = (SDL_GetPerformanceCounter() - begin) / frequency;
+
+        int arena_found = 0;
+        Path path;
+        begin = SDL_GetPerformanceCounter();
+        for (int q = 0; q < queries; q++) {
+            if (pathfinding_find_path_into(map.pathfinding, &map, starts[q], ends[q], &path)) arena_found++;
+        }
+        double arena_seconds = (SDL_GetPerformanceCounter() - begin) / frequency;
+
+        // Same queries again with the abstract graph built, the flat arena is
+        // still used for the short ones
+        map.hierarchy = hpa_build(&map, HPA_CLUSTER_SIZE);
+        PathfindingContext* hierarchical = pathfinding_context_create(&map);
+        int hpa_found = 0;
+        begin = SDL_GetPerformanceCounter();
+        for (int q = 0; q < queries; q++) {
+            if (pathfinding_find_path_into(hierarchical, &map, starts[q], ends[q], &path)) hpa_found++;
+        }
+        double hpa_seconds = (SDL_GetPerformanceCounter() - begin) / frequency;
+
+        if (legacy_found != arena_found || arena_found != hpa_found) {
+            printf("Warning: legacy found %d paths, arena found %d, hpa found %d\n", legacy_found, arena_found, hpa_found);
+        }
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", sizes[s], sizes[s]);
+        printf("%-10s %-8d %14.1f %14.1f %8.2fx %14.1f %8.2fx\n", label, queries,
+               queries / legacy_seconds, queries / arena_seconds, legacy_seconds / arena_seconds,
+               queries / hpa_seconds, legacy_seconds / hpa_seconds);
+
+        pathfinding_context_destroy(hierarchical);
+        hpa_destroy(map.hierarchy);
+        map.hierarchy = NULL;
+
+        free(starts);
+        free(ends);
+        pathfinding_context_destroy(map.pathfinding);
+        map.pathfinding = NULL;
+        map_destroy(&map);
+    }
+    return 0;
+}
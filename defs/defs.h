@@ -3,8 +3,18 @@
 
 #define WINDOW_WIDTH 640
 #define WINDOW_HEIGHT 480
-#define TARGET_FPS 60
-#define FRAME_DELAY (1000 / TARGET_FPS)
+// The simulation always advances in ticks of this length, whatever the
+// display rate is. Speeds and timers throughout the game are per tick
+#define TICK_RATE 60
+#define TICK_NS (1000000000ULL / TICK_RATE)
+// After a stall the simulation drops time instead of running this many ticks
+// in one frame to catch up
+#define MAX_TICKS_PER_FRAME 5
 #define CAMERA_LERP_SPEED 0.8f
+#define MAX_PATH_WORKERS 4
+// Search arenas of all the path workers together, every one is as large as
+// the map so big levels get fewer workers
+#define MAX_PATH_ARENA_BYTES ((size_t)256 << 20)
+#define MAX_JOB_WORKERS 8
                              
 #endif
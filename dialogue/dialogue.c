@@ -2,7 +2,9 @@
 #include "../text/text.h"
 #include <string.h>
 
-#define TEXT_SPEED 40 // Milliseconds per character
+// Ticks per character. Counting ticks instead of reading the clock keeps a
+// replayed conversation in step with the recorded one
+#define TEXT_SPEED 3
 
 // New static variables for animation
 static char** current_conversation = NULL;
@@ -10,23 +12,32 @@ static int total_lines = 0;
 static int current_line_index = 0;
 
 static int visible_chars = 0;
-static Uint64 last_char_time = 0;
+static int char_timer = 0;
 
-// This will be called every frame to advance the animation.
-void dialogue_update() {
-    if (!dialogue_is_active()) return;
+// The current line is laid out once when it comes up, the typewriter effect
+// only changes how many of its characters get drawn
+static TextLayout line_layout;
+static int line_length = 0;
+
+static void layout_current_line() {
+    SDL_Color white = {255, 255, 255, 255};
+    int wrap_width = 1100;
 
-    // Get the full text of the current line
     const char* full_line = current_conversation[current_line_index];
-    int line_length = strlen(full_line);
+    text_layout_wrapped(&line_layout, full_line, 30, 140, white, wrap_width);
+    line_length = strlen(full_line);
+}
+
+// This will be called every tick to advance the animation.
+void dialogue_update() {
+    if (!dialogue_is_active()) return;
 
     // If not all characters are visible yet
     if (visible_chars < line_length) {
-        Uint64 current_time = SDL_GetTicks();
-        // and if enough time has passed since the last character...
-        if (current_time > last_char_time + TEXT_SPEED) {
+        // and if enough ticks have passed since the last character...
+        if (++char_timer >= TEXT_SPEED) {
             visible_chars++; // reveal one more character.
-            last_char_time = current_time; // reset the timer.
+            char_timer = 0; // reset the timer.
         }
     }
 }
@@ -39,16 +50,14 @@ void dialogue_start_conversation(char** lines, int line_count) {
 
         // Reset animation state for the new conversation
         visible_chars = 0;
-        last_char_time = SDL_GetTicks();
+        char_timer = 0;
+        layout_current_line();
     }
 }
 
 void dialogue_advance() {
     if (!dialogue_is_active()) return;
 
-    const char* full_line = current_conversation[current_line_index];
-    int line_length = strlen(full_line);
-
     // If the line is still animating, pressing 'E' should reveal it instantly.
     if (visible_chars < line_length) {
         visible_chars = line_length;
@@ -60,7 +69,8 @@ void dialogue_advance() {
         } else {
             // Reset animation for the new line
             visible_chars = 0;
-            last_char_time = SDL_GetTicks();
+            char_timer = 0;
+            layout_current_line();
         }
     }
 }
@@ -70,6 +80,7 @@ void dialogue_end_conversation() {
     total_lines = 0;
     current_line_index = 0;
     visible_chars = 0;
+    line_length = 0;
 }
 
 void dialogue_render(SDL_Renderer* renderer) {
@@ -82,16 +93,7 @@ void dialogue_render(SDL_Renderer* renderer) {
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
         SDL_RenderRect(renderer, &dialogue_box);
 
-        SDL_Color white = {255, 255, 255, 255};
-        int wrap_width = 1100; 
-
-        const char* full_line = current_conversation[current_line_index];
-        
-        char render_buffer[MAX_DIALOGUE_LINE_LENGTH];
-        strncpy(render_buffer, full_line, visible_chars);
-        render_buffer[visible_chars] = '\0';
-
-        text_render_wrapped(renderer, render_buffer, 30, 140, white, wrap_width);
+        text_render_layout(renderer, &line_layout, visible_chars);
     }
 }
 
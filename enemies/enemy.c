@@ -2,77 +2,259 @@
 // This is without a doubt the most complex part of the game for now
 
 #include "enemy.h"
+#include "../helper/flowfield.h"
+#include "../helper/visibility.h"
+#include "../helper/trace.h"
 #include <SDL3/SDL_rect.h>
 #include <stdio.h>
+#include <stdlib.h>
+
+// Resizes one array of the store, the old contents are kept
+static bool grow_column(void* column, int capacity, size_t item_size) {
+    void** items = (void**)column;
+    void* grown = realloc(*items, (size_t)capacity * item_size);
+    if (!grown) return false;
+    *items = grown;
+    return true;
+}
 
-void enemy_create(Enemy* enemy, const EnemyData *data, const Map *map) {
-    // Set the enemy's dimensions from the parsed data
-    enemy->rect.w = data->size.x;
-    enemy->rect.h = data->size.y;
+// The centre of the rect is what the grid tracks
+static Vector2f enemy_center(const SDL_FRect* rect) {
+    return (Vector2f){ rect->x + rect->w / 2.0f, rect->y + rect->h / 2.0f };
+}
 
-    // Convert grid-based spawn coordinates to pixel coordinates
-    const float map_pixel_width = map->width * TILE_SIZE;
-    const float map_pixel_height = map->height * TILE_SIZE;
+bool enemy_store_init(EnemyStore* store, const Map* map) {
+    memset(store, 0, sizeof(*store));
+    store->grid = spatial_grid_create(map, SPATIAL_GRID_CELL_TILES);
+    if (!store->grid) return false;
+
+    const EnemyData* data = map->enemies;
+    const int count = map->enemy_count;
+    if (count == 0) return true;
+
+    store->configs = (EnemyConfig*)malloc(count * sizeof(EnemyConfig));
+    if (!store->configs) return false;
+    store->config_count = count;
+
+    // Initialize every type from level data
+    for (int i = 0; i < count; i++) {
+        EnemyConfig* config = &store->configs[i];
+        config->size = data[i].size;
+        config->sight_range = data[i].sight_range;
+        config->perception_radius = data[i].perception_radius;
+        config->attack_range = data[i].attack_range;
+        config->walking_speed = data[i].walking_speed;
+        config->stalking_speed = data[i].stalking_speed;
+        config->attacking_speed = data[i].attacking_speed;
+
+        printf("Initialized enemy type '%s' with:\n"
+               "  Size: (%.0f, %.0f)\n"
+               "  Sight: %.0f, Perception: %.0f, Attack Range: %.0f\n"
+               "  Speed (Walk/Stalk/Attack): %.1f/%.1f/%.1f\n",
+               data[i].id, config->size.x, config->size.y,
+               config->sight_range, config->perception_radius, config->attack_range,
+               config->walking_speed, config->stalking_speed, config->attacking_speed);
+
+        // Half the rect plus a tick of movement at the fastest speed, and a
+        // pixel for the corner indicators
+        float extent = SDL_max(config->size.x, config->size.y) / 2.0f + 1.0f
+            + SDL_max(config->walking_speed, SDL_max(config->stalking_speed, config->attacking_speed));
+        store->cull_margin = SDL_max(store->cull_margin, extent);
+
+        // Between two thinks a patrolling enemy keeps walking the same way, it
+        // must not get past the node it was walking to. Nodes count as reached
+        // within half a tile
+        int period = ENEMY_LOD_MAX_PERIOD;
+        while (period > 1 && period * config->walking_speed >= TILE_SIZE / 2.0f) {
+            period /= 2;
+        }
+        config->max_think_period = period;
+    }
+    return true;
+}
 
-    enemy->rect.x =  data->spawn_pos.x * TILE_SIZE;
-    enemy->rect.y =  data->spawn_pos.y * TILE_SIZE;
+bool enemy_store_reserve(EnemyStore* store, int capacity) {
+    if (capacity <= store->capacity) return true;
+    int new_capacity = store->capacity > 0 ? store->capacity : 64;
+    while (new_capacity < capacity) new_capacity *= 2;
+
+    // A column that fails leaves the ones before it larger than capacity,
+    // which is harmless, capacity only grows once they all made it
+    bool ok = grow_column(&store->rect, new_capacity, sizeof(*store->rect))
+        && grow_column(&store->previous_rect, new_capacity, sizeof(*store->previous_rect))
+        && grow_column(&store->vel, new_capacity, sizeof(*store->vel))
+        && grow_column(&store->state, new_capacity, sizeof(*store->state))
+        && grow_column(&store->rescan_timer, new_capacity, sizeof(*store->rescan_timer))
+        && grow_column(&store->patrol_timer, new_capacity, sizeof(*store->patrol_timer))
+        && grow_column(&store->alert_modifier, new_capacity, sizeof(*store->alert_modifier))
+        && grow_column(&store->last_think, new_capacity, sizeof(*store->last_think))
+        && grow_column(&store->think_period, new_capacity, sizeof(*store->think_period))
+        && grow_column(&store->last_known_player_pos, new_capacity, sizeof(*store->last_known_player_pos))
+        && grow_column(&store->path, new_capacity, sizeof(*store->path))
+        && grow_column(&store->path_job, new_capacity, sizeof(*store->path_job))
+        && grow_column(&store->rng, new_capacity, sizeof(*store->rng))
+        && grow_column(&store->config, new_capacity, sizeof(*store->config))
+        && grow_column(&store->query, new_capacity, sizeof(*store->query))
+        && grow_column(&store->think_list, new_capacity, sizeof(*store->think_list))
+        && spatial_grid_reserve(store->grid, new_capacity);
+    if (!ok) {
+        printf("Error: Could not make room for %d enemies\n", new_capacity);
+        return false;
+    }
+    store->capacity = new_capacity;
+    return true;
+}
 
-    // Initialize enemy from level data
-    enemy->sight_range = data->sight_range;
-    enemy->perception_radius = data->perception_radius;
-    enemy->attack_range = data->attack_range;
-    enemy->walking_speed = data->walking_speed;
-    enemy->stalking_speed = data->stalking_speed;
-    enemy->attacking_speed = data->attacking_speed;
+void enemy_store_destroy(EnemyStore* store) {
+    for (int i = 0; i < store->count; i++) {
+        path_destroy(store->path[i]);
+    }
+    free(store->rect);
+    free(store->previous_rect);
+    free(store->vel);
+    free(store->state);
+    free(store->rescan_timer);
+    free(store->patrol_timer);
+    free(store->alert_modifier);
+    free(store->last_known_player_pos);
+    free(store->path);
+    free(store->path_job);
+    free(store->rng);
+    free(store->config);
+    free(store->query);
+    free(store->last_think);
+    free(store->think_period);
+    free(store->think_list);
+    free(store->configs);
+    spatial_grid_destroy(store->grid);
+    memset(store, 0, sizeof(*store));
+}
+
+int enemy_spawn(EnemyStore* store, int config, Vector2 tile, uint64_t seed) {
+    if (config < 0 || config >= store->config_count) return -1;
+    if (!enemy_store_reserve(store, store->count + 1)) return -1;
+    const int i = store->count++;
+
+    // Convert grid-based spawn coordinates to pixel coordinates
+    const Vector2f size = store->configs[config].size;
+    store->rect[i] = (SDL_FRect){ tile.x * TILE_SIZE, tile.y * TILE_SIZE, size.x, size.y };
+    store->previous_rect[i] = store->rect[i];
 
     // Initialize AI state and other variables
-    enemy->vel.x = 0.0f;
-    enemy->vel.y = 0.0f;
-    enemy->current_state = AI_STATE_CLUELESS;
-    enemy->current_path = NULL;
-    enemy->rescan_timer = 90;
-    enemy->patrol_timer = 0;
-    enemy->alert_modifier = 0.5;
-
-    // --- **THE FIX: Completed debug printf statement** ---
-    printf("Initialized enemy '%s' with:\n"
-           "  Size: (%.0f, %.0f)\n"
-           "  Sight: %.0f, Perception: %.0f, Attack Range: %.0f\n"
-           "  Speed (Walk/Stalk/Attack): %.1f/%.1f/%.1f\n",
-           data->id, data->size.x, data->size.y,
-           enemy->sight_range, enemy->perception_radius, enemy->attack_range,
-           enemy->walking_speed, enemy->stalking_speed, enemy->attacking_speed);
+    store->vel[i] = (Vector2f){ 0.0f, 0.0f };
+    store->state[i] = AI_STATE_CLUELESS;
+    store->rescan_timer[i] = 90;
+    store->patrol_timer[i] = 0;
+    store->alert_modifier[i] = 0.5;
+    store->last_think[i] = store->tick;
+    store->think_period[i] = 1;
+    store->last_known_player_pos[i] = (Vector2f){ 0.0f, 0.0f };
+    store->path[i] = NULL;
+    store->path_job[i] = PATH_JOB_NONE;
+    rng_seed(&store->rng[i], seed);
+    store->config[i] = config;
+    spatial_grid_insert(store->grid, i, enemy_center(&store->rect[i]));
+    return i;
 }
 
 // These logics will pretty much be universal, but the variables that coordinate
 // them (anger, velocity, hearing distance, FOV) will be different for each
 // type of enemy
-static void enemy_logic_clueless(Enemy *enemy, const Player *player, const Map *map);
-static void enemy_logic_stalking(Enemy *enemy, const Player *player, const Map *map);
-static void enemy_logic_attacking(Enemy *enemy, const Player *player, const Map *map);
+static void enemy_logic_clueless(EnemyStore* store, int i, int elapsed, const Player *player, const Map *map);
+static void enemy_logic_stalking(EnemyStore* store, int i, int elapsed, const Player *player, const Map *map);
+static void enemy_logic_attacking(EnemyStore* store, int i, const Player *player, const Map *map);
+
+/// Line of sight to the player. Near the player this is a lookup in the shared
+/// visibility field, further away it falls back to tracing the ray
+static bool enemy_can_see_player(const Map* map, Vector2f enemy_pos, Vector2f player_pos) {
+    if (map->player_visibility && visibility_covers(map->player_visibility, player_pos, enemy_pos)) {
+        return visibility_can_see(map->player_visibility, enemy_pos);
+    }
+    return map_has_line_of_sight(map, enemy_pos, player_pos);
+}
+
+/// Replaces the path the enemy is following, the old one is freed
+static void enemy_set_path(EnemyStore* store, int i, Path* path) {
+    if (store->path[i]) {
+        path_destroy(store->path[i]);
+    }
+    store->path[i] = path;
+    // The first point is the tile the enemy is standing on, stalkers skip it
+    if (path && store->state[i] == AI_STATE_STALKING && path->count > 1) {
+        path->current_node = 1;
+    }
+}
+
+/// Drops the current path and forgets any search still running for the enemy
+static void enemy_clear_path(EnemyStore* store, int i, const Map* map) {
+    enemy_set_path(store, i, NULL);
+    if (store->path_job[i] != PATH_JOB_NONE) {
+        pathjobs_cancel(map->path_jobs, store->path_job[i]);
+        store->path_job[i] = PATH_JOB_NONE;
+    }
+}
+
+/// Asks for a new path. With a job system the search runs on a worker thread
+/// and the enemy keeps following its current path until the new one arrives
+static void enemy_request_path(EnemyStore* store, int i, const Map* map, Vector2f from, Vector2f to) {
+    if (map->path_jobs) {
+        if (store->path_job[i] != PATH_JOB_NONE) {
+            pathjobs_cancel(map->path_jobs, store->path_job[i]);
+        }
+        // When the request can't be queued the current path is kept and the
+        // enemy asks again on a later tick, the search never falls back to
+        // running here, outside the workers' budget
+        store->path_job[i] = pathjobs_submit(map->path_jobs, (uint32_t)i, from, to);
+        return;
+    }
+    // Without workers the search runs inline in the level's one arena, the
+    // thinking then stays on the main thread
+    enemy_set_path(store, i, pathfinding_find_path(map, from, to));
+}
+
+/// Picks up the result of a finished search, if there is one
+static void enemy_collect_path(EnemyStore* store, int i, const Map* map) {
+    if (store->path_job[i] == PATH_JOB_NONE) return;
+
+    Path* path = NULL;
+    PathJobStatus status = pathjobs_poll(map->path_jobs, store->path_job[i], &path);
+    if (status != PATH_JOB_PENDING) {
+        store->path_job[i] = PATH_JOB_NONE;
+        enemy_set_path(store, i, path);
+    }
+}
 
 /// This is the function that updated the enemies
 /// This function coordinates movement, state, collisions and pathfinding
-void enemy_update(Enemy* enemy, const Player* player, const Map* map) {
+void enemy_think(EnemyStore* store, int i, const Player* player, const Map* map) {
+    // Timers run on ticks, an enemy the scheduler skipped catches up here
+    const int elapsed = store->tick - store->last_think[i];
+    store->last_think[i] = store->tick;
+
     // Resets the speed so it doesn't add up to infinity
-    enemy->vel.x = 0;
-    enemy->vel.y = 0;
+    store->vel[i].x = 0;
+    store->vel[i].y = 0;
+
+    // Searches requested on earlier ticks may have finished by now
+    enemy_collect_path(store, i, map);
 
     // This is the enemy brain
-    switch (enemy->current_state) {
+    switch (store->state[i]) {
         case AI_STATE_CLUELESS:
-            enemy_logic_clueless(enemy, player, map);
+            enemy_logic_clueless(store, i, elapsed, player, map);
             break;
         case AI_STATE_STALKING:
-            enemy_logic_stalking(enemy, player, map);
+            enemy_logic_stalking(store, i, elapsed, player, map);
             break;
         case AI_STATE_ATTACKING:
-            enemy_logic_attacking(enemy, player, map);
+            enemy_logic_attacking(store, i, player, map);
             break;
         default:
             break;
     }
+}
 
+void enemy_apply(EnemyStore* store, int i, const Map* map) {
     // Starts collision handler
     // Could be it's own function
 
@@ -82,49 +264,147 @@ void enemy_update(Enemy* enemy, const Player* player, const Map* map) {
 
     // Now this is important, it's what keeps the enemy from being stuck on corners
     const float COLLISION_INSET = 2.f; 
+    SDL_FRect* rect = &store->rect[i];
+    const Vector2f vel = store->vel[i];
 
     // The collision check should be pretty straight up
-    enemy->rect.x += enemy->vel.x;
+    rect->x += vel.x;
 
     // Gets all the grids near the enemy object
-    int grid_x_left = (enemy->rect.x + COLLISION_INSET) / TILE_SIZE;
-    int grid_x_right = (enemy->rect.x + enemy->rect.w - COLLISION_INSET) / TILE_SIZE;
-    int grid_y_top = (enemy->rect.y + COLLISION_INSET) / TILE_SIZE;
-    int grid_y_bottom = (enemy->rect.y + enemy->rect.h - COLLISION_INSET) / TILE_SIZE;
+    int grid_x_left = (rect->x + COLLISION_INSET) / TILE_SIZE;
+    int grid_x_right = (rect->x + rect->w - COLLISION_INSET) / TILE_SIZE;
+    int grid_y_top = (rect->y + COLLISION_INSET) / TILE_SIZE;
+    int grid_y_bottom = (rect->y + rect->h - COLLISION_INSET) / TILE_SIZE;
     
-    if (enemy->vel.x > 0) { // Moving right
-        if (map->tiles[grid_y_top][grid_x_right] != 0 || map->tiles[grid_y_bottom][grid_x_right] != 0) {
+    if (vel.x > 0) { // Moving right
+        if (map_is_wall(map, grid_x_right, grid_y_top) || map_is_wall(map, grid_x_right, grid_y_bottom)) {
             // If top right or bottom right are not empty
             // This will 100% be changed to walkable, and a function will be added to the map
             // that checks if tile is walkable or not
-            enemy->rect.x = grid_x_right * TILE_SIZE - enemy->rect.w;
+            rect->x = grid_x_right * TILE_SIZE - rect->w;
         }
-    } else if (enemy->vel.x < 0) { // Moving left
-        if (map->tiles[grid_y_top][grid_x_left] != 0 || map->tiles[grid_y_bottom][grid_x_left] != 0) {
+    } else if (vel.x < 0) { // Moving left
+        if (map_is_wall(map, grid_x_left, grid_y_top) || map_is_wall(map, grid_x_left, grid_y_bottom)) {
             // Same for the right one
-            enemy->rect.x =  (grid_x_left + 1) * TILE_SIZE - enemy->rect.w;
+            rect->x =  (grid_x_left + 1) * TILE_SIZE - rect->w;
         }
     }
 
     // Handle Y-axis collision
     // The comments for this area are pretty much the same of the above
-    enemy->rect.y += enemy->vel.y;
+    rect->y += vel.y;
     
     // Recalculate grid positions with the inset
-    grid_x_left = (enemy->rect.x + COLLISION_INSET) / TILE_SIZE;
-    grid_x_right = (enemy->rect.x + enemy->rect.w - COLLISION_INSET) / TILE_SIZE;
-    grid_y_top = (enemy->rect.y + COLLISION_INSET) / TILE_SIZE;
-    grid_y_bottom = (enemy->rect.y + enemy->rect.h - COLLISION_INSET) / TILE_SIZE;
-
-    if (enemy->vel.y > 0) { // Moving down
-         if (map->tiles[grid_y_bottom][grid_x_left] != 0 || map->tiles[grid_y_bottom][grid_x_right] != 0) {
-            enemy->rect.y = grid_y_bottom * TILE_SIZE - enemy->rect.h;
+    grid_x_left = (rect->x + COLLISION_INSET) / TILE_SIZE;
+    grid_x_right = (rect->x + rect->w - COLLISION_INSET) / TILE_SIZE;
+    grid_y_top = (rect->y + COLLISION_INSET) / TILE_SIZE;
+    grid_y_bottom = (rect->y + rect->h - COLLISION_INSET) / TILE_SIZE;
+
+    if (vel.y > 0) { // Moving down
+         if (map_is_wall(map, grid_x_left, grid_y_bottom) || map_is_wall(map, grid_x_right, grid_y_bottom)) {
+            rect->y = grid_y_bottom * TILE_SIZE - rect->h;
         }
-    } else if (enemy->vel.y < 0) { // Moving up
-        if (map->tiles[grid_y_top][grid_x_left] != 0 || map->tiles[grid_y_top][grid_x_right] != 0) {
-            enemy->rect.y = (grid_y_top + 1) * TILE_SIZE;
+    } else if (vel.y < 0) { // Moving up
+        if (map_is_wall(map, grid_x_left, grid_y_top) || map_is_wall(map, grid_x_right, grid_y_top)) {
+            rect->y = (grid_y_top + 1) * TILE_SIZE;
         }
     }
+
+    spatial_grid_move(store->grid, i, enemy_center(rect));
+}
+
+#define ENEMY_THINK_GRAIN 64 // Enemies per job, a think is a few microseconds
+
+typedef struct {
+    EnemyStore* store;
+    const Player* player;
+    const Map* map;
+} ThinkJob;
+
+static void enemy_think_range(void* data, int begin, int end) {
+    ThinkJob* job = (ThinkJob*)data;
+    for (int k = begin; k < end; ++k) {
+        const int i = job->store->think_list[k];
+        TRACE_BEGIN_ARGS("enemy", "index", i, "state", job->store->state[i]);
+        enemy_think(job->store, i, job->player, job->map);
+        TRACE_END_ARGS("enemy", "new_state", job->store->state[i], NULL, 0);
+    }
+}
+
+/// Ticks the enemy can go between thinks, a power of two, see ENEMY_LOD_NEAR
+static int enemy_think_period(const EnemyStore* store, int i, const Player* player) {
+    if (store->state[i] != AI_STATE_CLUELESS) return 1;
+
+    // How far the enemy could notice the player from, taking the loudest the
+    // player can get so breaking into a run never goes unheard
+    const EnemyConfig* config = &store->configs[store->config[i]];
+    Vector2f player_pos = { player->rect.x, player->rect.y };
+    Vector2f enemy_pos = { store->rect[i].x, store->rect[i].y };
+    float reach = SDL_max(config->sight_range, config->perception_radius * PLAYER_RUNNING_NOISE) * store->alert_modifier[i];
+    float beyond = vector_magnitude(vector_subtract(player_pos, enemy_pos)) - reach - ENEMY_LOD_NEAR;
+    if (beyond <= 0.0f) return 1;
+
+    int period = 2;
+    while (period < config->max_think_period && beyond > ENEMY_LOD_BAND * (period / 2)) {
+        period *= 2;
+    }
+    return SDL_min(period, config->max_think_period);
+}
+
+static bool enemy_think_due(const EnemyStore* store, int i) {
+    const int period = store->think_period[i];
+    // Its turn in the rotation, or it missed it to the budget or to a period change
+    return ((store->tick + i) & (period - 1)) == 0 || store->tick - store->last_think[i] >= period;
+}
+
+/// Fills think_list with the enemies thinking this tick and returns how many.
+/// Full rate ones always do, the reduced rate ones that are due take turns on
+/// the budget starting at think_cursor
+static int enemy_schedule(EnemyStore* store, const Player* player) {
+    int listed = 0;
+    int due = 0;
+    for (int i = 0; i < store->count; ++i) {
+        store->think_period[i] = enemy_think_period(store, i, player);
+        if (store->think_period[i] == 1) {
+            store->think_list[listed++] = i;
+        } else if (enemy_think_due(store, i)) {
+            due++;
+        }
+    }
+
+    int taken = 0;
+    const int start = store->think_cursor;
+    for (int k = 0; k < store->count && taken < due && taken < ENEMY_THINK_BUDGET; ++k) {
+        const int i = (start + k) % store->count;
+        if (store->think_period[i] > 1 && enemy_think_due(store, i)) {
+            store->think_list[listed++] = i;
+            store->think_cursor = i + 1;
+            taken++;
+        }
+    }
+    store->over_budget = due - taken;
+    return listed;
+}
+
+void enemy_store_update(EnemyStore* store, JobSystem* jobs, const Player* player, const Map* map) {
+    store->tick++;
+    TRACE_BEGIN("enemy schedule");
+    store->thinking = enemy_schedule(store, player);
+    store->deferred = store->count - store->thinking;
+    TRACE_END_ARGS("enemy schedule", "thinking", store->thinking, "deferred", store->deferred);
+
+    // Without path workers every search runs inline in the shared arena, so
+    // the thinking has to stay on this thread
+    if (!map->path_jobs) jobs = NULL;
+
+    ThinkJob job = { store, player, map };
+    jobs_parallel_for(jobs, store->thinking, ENEMY_THINK_GRAIN, enemy_think_range, &job);
+
+    TRACE_BEGIN("enemy apply");
+    for (int i = 0; i < store->count; ++i) {
+        enemy_apply(store, i, map);
+    }
+    TRACE_END("enemy apply");
 }
 
 /// The enemy is clueless when he does not know that there is a player near by
@@ -132,9 +412,10 @@ void enemy_update(Enemy* enemy, const Player* player, const Map* map) {
 /// a player in the area, and currently, he does
 /// Because of that, in the future the state ALERTED will be added
 /// This function is currently a bit of both ALERTED and CLUELESS states
-static void enemy_logic_clueless(Enemy *enemy, const Player *player, const Map *map) {
+static void enemy_logic_clueless(EnemyStore* store, int i, int elapsed, const Player *player, const Map *map) {
+    const EnemyConfig* config = &store->configs[store->config[i]];
     Vector2f player_pos = {player->rect.x, player->rect.y};
-    Vector2f enemy_pos = {enemy->rect.x, enemy->rect.y};
+    Vector2f enemy_pos = {store->rect[i].x, store->rect[i].y};
 
     // Always check for the player first
     // If the player is detected change state immediately
@@ -142,66 +423,59 @@ static void enemy_logic_clueless(Enemy *enemy, const Player *player, const Map *
     bool detected = false;
 
     // If the enemy HEARS the player
-    if (distance_to_player < (enemy->perception_radius * player->noise * enemy->alert_modifier)) {
-        enemy->alert_modifier += 0.1;
+    if (distance_to_player < (config->perception_radius * player->noise * store->alert_modifier[i])) {
+        store->alert_modifier[i] += 0.1;
         detected = true;
     }
     // If the enemy SEES the player
-    if (!detected && distance_to_player < (enemy->sight_range * enemy->alert_modifier)) {
-        if (map_has_line_of_sight(map, enemy_pos, player_pos)) {
-            enemy->alert_modifier += 0.1;
+    if (!detected && distance_to_player < (config->sight_range * store->alert_modifier[i])) {
+        if (enemy_can_see_player(map, enemy_pos, player_pos)) {
+            store->alert_modifier[i] += 0.1;
             detected = true;
         }
     }
 
     if (detected) {
         printf("[Enemy] Player detected! Transitioning to STALKING.\n");
-        if (enemy->current_path) {
-            path_destroy(enemy->current_path);
-            enemy->current_path = NULL;
-        }
-        enemy->last_known_player_pos = player_pos;
-        enemy->current_state = AI_STATE_STALKING;
+        enemy_clear_path(store, i, map);
+        store->last_known_player_pos[i] = player_pos;
+        store->state[i] = AI_STATE_STALKING;
         return; // Exit immediately
     }
 
     // Patrols the area randomly
     // This function is currently weird af I need to study it
-    if (--enemy->patrol_timer <= 0 || enemy->current_path == NULL) {
-        if (enemy->current_path) { // Clear old path if it exists
-            path_destroy(enemy->current_path);
-            enemy->current_path = NULL;
-        }
+    // A path that is still being searched counts as having one
+    store->patrol_timer[i] -= elapsed;
+    if (store->patrol_timer[i] <= 0 || (store->path[i] == NULL && store->path_job[i] == PATH_JOB_NONE)) {
         // This function currently has a bug
         // If the player closes the game while the enemy is walking a random path
         // the memory IS NOT FREED and upon a new instance of the game, a core dump
         // could happen.
         // To fix this just free the damn path on closing the game
         // That's why every object must have a "free" function
-        Vector2f patrol_target = map_get_random_walkable_tile(map);
-        enemy->current_path = pathfinding_find_path(map, enemy_pos, patrol_target);
-        enemy->patrol_timer = 900; // Reset timer
+        Vector2f patrol_target = map_get_random_walkable_tile(map, &store->rng[i]);
+        enemy_request_path(store, i, map, enemy_pos, patrol_target);
+        store->patrol_timer[i] = 900; // Reset timer
     }
 
     // Follows the path, this is a standard function and could be separated
-    if (enemy->current_path != NULL && enemy->current_path->current_node < enemy->current_path->count) {
-        Vector2f target_pos = enemy->current_path->points[enemy->current_path->current_node];
+    Path* path = store->path[i];
+    if (path != NULL && path->current_node < path->count) {
+        Vector2f target_pos = path->points[path->current_node];
         Vector2f dir = vector_subtract(target_pos, enemy_pos);
         float distance = vector_magnitude(dir);
 
         if (distance < TILE_SIZE / 2.0f) {
-            enemy->current_path->current_node++;
+            path->current_node++;
         } else {
             Vector2f norm_dir = vector_normalize(dir);
-            enemy->vel.x = norm_dir.x * enemy->walking_speed;
-            enemy->vel.y = norm_dir.y * enemy->walking_speed;
+            store->vel[i].x = norm_dir.x * config->walking_speed;
+            store->vel[i].y = norm_dir.y * config->walking_speed;
         }
     } else {
         // Reached destination or path failed, clear path to get a new one next tick
-        if (enemy->current_path) {
-            path_destroy(enemy->current_path);
-            enemy->current_path = NULL;
-        }
+        enemy_set_path(store, i, NULL);
     }
 }
 
@@ -210,100 +484,116 @@ static void enemy_logic_clueless(Enemy *enemy, const Player *player, const Map *
 /// from attacking, while stalking the enemy should try to remain UNSEEN by the
 /// player at all times, an if the player sees him, he either attacks or hides.
 /// To choose if it flees or attacks distance and a random 50/50 should be the weights
-static void enemy_logic_stalking(Enemy *enemy, const Player *player, const Map *map) {
+static void enemy_logic_stalking(EnemyStore* store, int i, int elapsed, const Player *player, const Map *map) {
+    const EnemyConfig* config = &store->configs[store->config[i]];
     Vector2f player_pos = { player->rect.x, player->rect.y };
-    Vector2f enemy_pos = { enemy->rect.x, enemy->rect.y };
+    Vector2f enemy_pos = { store->rect[i].x, store->rect[i].y };
 
     // Re-scans every half a second to keep
-    if (--enemy->rescan_timer <= 0) {
-        enemy->rescan_timer = 90;
+    store->rescan_timer[i] -= elapsed;
+    if (store->rescan_timer[i] <= 0) {
+        store->rescan_timer[i] = 90;
         float distance = vector_magnitude(vector_subtract(player_pos, enemy_pos));
         if (
-                (distance < (enemy->sight_range * enemy->alert_modifier) && map_has_line_of_sight(map, enemy_pos, player_pos))
+                (distance < (config->sight_range * store->alert_modifier[i]) && enemy_can_see_player(map, enemy_pos, player_pos))
                 || // Please just create a fixed boolean instead of writing this every time
-                (distance < (enemy->perception_radius * player->noise * enemy->alert_modifier))
+                (distance < (config->perception_radius * player->noise * store->alert_modifier[i]))
                 ) {
-            enemy->last_known_player_pos = player_pos;
-            if (enemy->current_path) {
+            store->last_known_player_pos[i] = player_pos;
+            if (store->path[i]) {
                 printf("[ENEMY] Updated player pos\n");
-                path_destroy(enemy->current_path);
-                enemy->current_path = NULL;
+                enemy_request_path(store, i, map, enemy_pos, store->last_known_player_pos[i]);
             }
-            if (distance < enemy->attack_range && map_has_line_of_sight(map, enemy_pos, player_pos)) {
-                enemy->current_state = AI_STATE_ATTACKING;
+            if (distance < config->attack_range && enemy_can_see_player(map, enemy_pos, player_pos)) {
+                store->state[i] = AI_STATE_ATTACKING;
                 printf("[ENEMY] Entering attack mode.\n");
                 return;
             }
         }
     }
 
+    // When the enemy is chasing the tile the player is standing on, the shared
+    // flow field already knows the next step and no search is needed
+    Vector2f next_step;
+    if (map->player_flow
+            && flowfield_targets(map->player_flow, store->last_known_player_pos[i])
+            && flowfield_next_step(map->player_flow, enemy_pos, &next_step)) {
+        enemy_clear_path(store, i, map);
+        Vector2f norm_dir = vector_normalize(vector_subtract(next_step, enemy_pos));
+        store->vel[i].x = norm_dir.x * config->stalking_speed;
+        store->vel[i].y = norm_dir.y * config->stalking_speed;
+        return;
+    }
+
     // Pathfinding
 
-    if (enemy->current_path == NULL) {
-        enemy->current_path = pathfinding_find_path(map, enemy_pos, enemy->last_known_player_pos);
-        if (enemy->current_path != NULL && enemy->current_path->count > 1) {
-            enemy->current_path->current_node = 1;
-        }
+    if (store->path[i] == NULL && store->path_job[i] == PATH_JOB_NONE) {
+        enemy_request_path(store, i, map, enemy_pos, store->last_known_player_pos[i]);
     }
 
-    if (enemy->current_path != NULL && enemy->current_path->current_node < enemy->current_path->count) {
-        Vector2f target_pos = enemy->current_path->points[enemy->current_path->current_node];
+    Path* path = store->path[i];
+    if (path != NULL && path->current_node < path->count) {
+        Vector2f target_pos = path->points[path->current_node];
         Vector2f dir = vector_subtract(target_pos, enemy_pos);
         float distance = vector_magnitude(dir);
 
         if (distance < TILE_SIZE / 2.0f) {
-            enemy->current_path->current_node++;
+            path->current_node++;
         } else {
             Vector2f norm_dir = vector_normalize(dir);
-            enemy->vel.x = norm_dir.x * enemy->stalking_speed;
-            enemy->vel.y = norm_dir.y * enemy->stalking_speed;
+            store->vel[i].x = norm_dir.x * config->stalking_speed;
+            store->vel[i].y = norm_dir.y * config->stalking_speed;
         }
+    } else if (store->path_job[i] != PATH_JOB_NONE) {
+        // Waits in place until the search comes back
     } else {
-        if (enemy->current_path) {
-            path_destroy(enemy->current_path);
-            enemy->current_path = NULL;
-        }
-        enemy->current_state = AI_STATE_CLUELESS;
-        enemy->alert_modifier += .5;
+        enemy_set_path(store, i, NULL);
+        store->state[i] = AI_STATE_CLUELESS;
+        store->alert_modifier[i] += .5;
     }
 }
 
 // I NEED TO ADD PATHFINDING TO THIS FUNCTION?
-static void enemy_logic_attacking(Enemy *enemy, const Player *player, const Map *map) {
+static void enemy_logic_attacking(EnemyStore* store, int i, const Player *player, const Map *map) {
+    const EnemyConfig* config = &store->configs[store->config[i]];
     Vector2f player_pos = { player->rect.x, player->rect.y };
-    Vector2f enemy_pos = { enemy->rect.x, enemy->rect.y };
+    Vector2f enemy_pos = { store->rect[i].x, store->rect[i].y };
     float distance = vector_magnitude(vector_subtract(player_pos, enemy_pos));
 
     if (
-            ((distance > (enemy->attack_range))
+            ((distance > (config->attack_range))
             ||
-            !map_has_line_of_sight(map, enemy_pos, player_pos))
+            !enemy_can_see_player(map, enemy_pos, player_pos))
             ) {
         printf("[ENEMY] Lost player line of sight\n");
-        enemy->last_known_player_pos = player_pos;
-        enemy->current_state = AI_STATE_STALKING;
+        store->last_known_player_pos[i] = player_pos;
+        store->state[i] = AI_STATE_STALKING;
         return;
     }
 
     Vector2f dir = vector_normalize(vector_subtract(player_pos, enemy_pos));
-    enemy->vel.x = dir.x * enemy->attacking_speed;
-    enemy->vel.y = dir.y * enemy->attacking_speed;
+    store->vel[i].x = dir.x * config->attacking_speed;
+    store->vel[i].y = dir.y * config->attacking_speed;
 }
 
-void enemy_render(Enemy* enemy, SDL_Renderer* renderer, const SDL_FRect *camera) {
+void enemy_render(const EnemyStore* store, int index, RenderBatch* batch, const SDL_FRect *camera, float alpha) {
+    SDL_FRect world_rect = render_lerp_rect(&store->previous_rect[index], &store->rect[index], alpha);
+    // The corner indicators stick out a pixel past the rect
+    SDL_FRect bounds = { world_rect.x - 1.0f, world_rect.y - 1.0f, world_rect.w + 2.0f, world_rect.h + 2.0f };
+    if (!render_batch_visible(batch, &bounds)) return;
+
     // Create a temporary rect for rendering, adjusted by the camera's position
     SDL_FRect render_rect = {
-        .x = enemy->rect.x - camera->x,
-        .y = enemy->rect.y - camera->y,
-        .w = enemy->rect.w,
-        .h = enemy->rect.h
+        .x = world_rect.x - camera->x,
+        .y = world_rect.y - camera->y,
+        .w = world_rect.w,
+        .h = world_rect.h
     };
 
-    SDL_SetRenderDrawColor(renderer, 255, 0, 0, SDL_ALPHA_OPAQUE);
-    SDL_RenderRect(renderer, &render_rect);
+    render_batch_rect(batch, &render_rect, (SDL_Color){ 255, 0, 0, SDL_ALPHA_OPAQUE });
 
     // The collision point indicators will also be drawn relative to the camera now
-    SDL_SetRenderDrawColor(renderer, 255, 255, 0, SDL_ALPHA_OPAQUE);
+    const SDL_Color indicator_color = { 255, 255, 0, SDL_ALPHA_OPAQUE };
     SDL_FPoint corners[4] = {
         {render_rect.x, render_rect.y},
         {render_rect.x + render_rect.w, render_rect.y},
@@ -313,6 +603,20 @@ void enemy_render(Enemy* enemy, SDL_Renderer* renderer, const SDL_FRect *camera)
 
     for (int i = 0; i < 4; ++i) {
         SDL_FRect corner_indicator = { corners[i].x - 1.0f, corners[i].y - 1.0f, 2.0f, 2.0f };
-        SDL_RenderFillRect(renderer, &corner_indicator);
+        render_batch_fill_rect(batch, &corner_indicator, indicator_color);
+    }
+}
+
+void enemy_render_visible(EnemyStore* store, RenderBatch* batch, const SDL_FRect *camera, float alpha) {
+    const SDL_FRect area = {
+        camera->x - store->cull_margin,
+        camera->y - store->cull_margin,
+        camera->w + store->cull_margin * 2.0f,
+        camera->h + store->cull_margin * 2.0f
+    };
+    // The scratch holds every enemy, the query can't run out of room
+    int count = spatial_grid_query_rect(store->grid, &area, store->query, store->count);
+    for (int i = 0; i < count; ++i) {
+        enemy_render(store, store->query[i], batch, camera, alpha);
     }
 }
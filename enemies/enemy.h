@@ -5,6 +5,10 @@
 #include "../player/player.h"
 #include "../helper/vector.h"
 #include "../helper/pathfinding.h"
+#include "../helper/pathjobs.h"
+#include "../helper/render_batch.h"
+#include "../helper/spatial_grid.h"
+#include "../helper/jobs.h"
 #include "../map/map.h"
 
 typedef enum {
@@ -18,9 +22,9 @@ typedef enum {
     AI_STATE_INVESTIGATING, // Checks the radius of last player location
 } AI_State;
 
+/// Tuning shared by every enemy spawned from the same level definition
 typedef struct {
-    SDL_FRect rect;
-    Vector2f vel;
+    Vector2f size;
 
     float sight_range;
     float perception_radius;
@@ -30,17 +34,91 @@ typedef struct {
     float stalking_speed;
     float attacking_speed;
 
-    int rescan_timer;
-    int patrol_timer;
-    int attacking_timer;
-    float alert_modifier;
-    AI_State current_state;
-    Vector2f last_known_player_pos;
-    Path *current_path;
-} Enemy;
-
-void enemy_create(Enemy* enemy, const EnemyData *data, const Map *map);
-void enemy_update(Enemy* enemy, const Player* player, const Map *level_map);
-void enemy_render(Enemy* enemy, SDL_Renderer* renderer, const SDL_FRect *camera);
+    int max_think_period; // Longest the scheduler lets it go without thinking, see below
+} EnemyConfig;
+
+/// Level of detail for the enemy brains
+/// Enemies that are after the player, or that could notice the player soon,
+/// think every tick. A clueless enemy further away than that only patrols, so
+/// it thinks every 2, 4 or 8 ticks depending on the distance and keeps its
+/// velocity in between, never so long that it could walk past the next node
+/// of its path. Enemies with the same period are spread over the ticks
+/// by their index, the work per tick stays flat instead of coming in waves.
+/// On top of that at most ENEMY_THINK_BUDGET reduced rate thinks run per
+/// tick, the ones over it wait for the next tick
+#define ENEMY_LOD_NEAR       400.0f // Past the edge of the screen, anything on it thinks every tick
+#define ENEMY_LOD_BAND       400.0f // Every band further out doubles the period
+#define ENEMY_LOD_MAX_PERIOD 8
+#define ENEMY_THINK_BUDGET   512
+
+/// Every enemy of the level, stored one array per field
+/// The fields the update touches every tick each get their own contiguous
+/// array, so a pass over thousands of enemies only streams through what it
+/// reads. Tuning that never changes lives once per definition in configs.
+/// An enemy is an index into the arrays, they all grow together
+typedef struct {
+    int count;
+    int capacity;
+
+    // Hot, read or written by every enemy every tick
+    SDL_FRect* rect;
+    SDL_FRect* previous_rect;   // rect at the start of the last tick, for interpolation
+    Vector2f* vel;
+    AI_State* state;
+    int* rescan_timer;
+    int* patrol_timer;
+    float* alert_modifier;
+    int* last_think;            // Tick of the last enemy_think, timers count the ticks since
+    int* think_period;          // Ticks between thinks the scheduler gave it this tick
+
+    // Warm, only some states use them
+    Vector2f* last_known_player_pos;
+    Path** path;
+    PathJobHandle* path_job;    // Search still running on a worker, PATH_JOB_NONE if idle
+    Rng* rng;                   // Each enemy's own random stream, see helper/rng.h
+    int* config;                // Index into configs
+
+    // Cold
+    EnemyConfig* configs;
+    int config_count;
+
+    SpatialGrid* grid;          // Every enemy by the centre of its rect, kept up to date as they move
+    int* query;                 // Scratch for grid queries, capacity long
+    float cull_margin;          // How far an enemy can be drawn from its grid position
+
+    // Scheduler
+    int tick;                   // enemy_store_update calls so far
+    int* think_list;            // Enemies thinking this tick, capacity long
+    int think_cursor;           // Where the budget starts picking on the next tick
+    int thinking;               // Enemies that thought on the last tick
+    int deferred;               // Enemies that didn't, skipped by their period or over the budget
+    int over_budget;            // The part of deferred that was due but didn't fit the budget
+} EnemyStore;
+
+// Copies the tuning of every definition of the level, config i is
+// map->enemies[i], and sets up an empty grid over the map
+bool enemy_store_init(EnemyStore* store, const Map* map);
+// Makes room for capacity enemies up front, spawning past it still works
+bool enemy_store_reserve(EnemyStore* store, int capacity);
+// Frees the arrays and every enemy's path
+void enemy_store_destroy(EnemyStore* store);
+
+// Adds an enemy standing on the tile, seed starts its random stream so give
+// every enemy a different one. Returns its index, or -1 when out of memory
+int enemy_spawn(EnemyStore* store, int config, Vector2 tile, uint64_t seed);
+
+/// An update is split in two. enemy_think runs the senses and the state machine
+/// and decides where to go, it writes nothing but the enemy's own entries, so
+/// any number of enemies can think at once. enemy_apply moves the enemy,
+/// resolves the wall collisions and updates the grid, which is shared
+void enemy_think(EnemyStore* store, int index, const Player* player, const Map *level_map);
+void enemy_apply(EnemyStore* store, int index, const Map *level_map);
+// Thinks for the enemies the scheduler picks across the job workers, then
+// applies every enemy one by one in index order. The result is the same
+// whatever the worker count, jobs can be NULL
+void enemy_store_update(EnemyStore* store, JobSystem* jobs, const Player* player, const Map *level_map);
+void enemy_render(const EnemyStore* store, int index, RenderBatch* batch, const SDL_FRect *camera, float alpha);
+// Renders the enemies the grid has near the camera instead of going over all of them
+void enemy_render_visible(EnemyStore* store, RenderBatch* batch, const SDL_FRect *camera, float alpha);
 
 #endif // ENEMY_H
@@ -0,0 +1,284 @@
+// stalker-c/game/game.c
+
+#include "game.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../defs/defs.h"
+#include "../dialogue/dialogue.h"
+#include "../helper/pathfinding.h"
+#include "../helper/hpa.h"
+#include "../helper/flowfield.h"
+#include "../helper/pathjobs.h"
+#include "../helper/visibility.h"
+#include "../helper/spatial_grid.h"
+#include "../helper/jobs.h"
+#include "../helper/profiler.h"
+#include "../helper/trace.h"
+#include "../map/map_cache.h"
+
+// Game variables
+GameState current_game_state;
+Map current_level_map;
+Player player;
+EnemyStore enemies;
+NPC* npcs = NULL;
+int active_npc_count = 0;
+Camera camera;
+Camera previous_camera;
+
+int game_enemy_workers = GAME_WORKERS_AUTO;
+
+static SpatialGrid* npc_grid = NULL; // NPCs by their centre, they never move
+static JobSystem* enemy_jobs = NULL;
+
+/// Tiles the player's flow field has to span. An enemy starts chasing the
+/// player's tile when it sees or hears the player, the field covers the
+/// furthest any enemy of the level can do that from with a running player
+static int game_flow_radius(const Map* map) {
+    float reach = 0.0f;
+    for (int i = 0; i < map->enemy_count; ++i) {
+        const EnemyData* data = &map->enemies[i];
+        reach = SDL_max(reach, SDL_max(data->sight_range, data->perception_radius * PLAYER_RUNNING_NOISE));
+    }
+    return (int)(reach / TILE_SIZE) + 1;
+}
+
+bool game_load(const char* level_path, SDL_Renderer* renderer, uint64_t seed, bool deterministic) {
+    map_load_from_file(&current_level_map, level_path);
+    if (current_level_map.tiles == NULL) return false;
+    // The hierarchy has to exist before the arenas, which size their scratch
+    // memory from it
+    current_level_map.hierarchy = hpa_build(&current_level_map, HPA_CLUSTER_SIZE);
+    current_level_map.player_flow = flowfield_create(&current_level_map, game_flow_radius(&current_level_map));
+    current_level_map.player_visibility = visibility_create(&current_level_map, VISIBILITY_DEFAULT_RADIUS);
+    // Leaves one core for the main thread
+    int path_workers = SDL_GetNumLogicalCPUCores() - 1;
+    if (path_workers > MAX_PATH_WORKERS) path_workers = MAX_PATH_WORKERS;
+    current_level_map.path_jobs = pathjobs_create(&current_level_map, path_workers);
+    if (current_level_map.path_jobs && deterministic) {
+        pathjobs_set_blocking(current_level_map.path_jobs, true);
+    }
+    // Without workers the enemies search inline, every query reusing one
+    // arena. The workers have their own, a map sized one more would sit idle
+    if (!current_level_map.path_jobs) {
+        current_level_map.pathfinding = pathfinding_context_create(&current_level_map);
+    }
+    // The enemy workers only run while the main thread waits on them, they
+    // can share the cores with the path workers
+    int enemy_workers = game_enemy_workers;
+    if (enemy_workers == GAME_WORKERS_AUTO) {
+        enemy_workers = SDL_min(SDL_GetNumLogicalCPUCores() - 1, MAX_JOB_WORKERS);
+    }
+    if (enemy_workers > 0) {
+        enemy_jobs = jobs_create(enemy_workers);
+    }
+    if (renderer) {
+        current_level_map.render_cache = map_cache_create(&current_level_map, renderer);
+    }
+    player_create(&player, &current_level_map);
+
+    // Every E# marker is one enemy, using the tuning of its definition
+    if (!enemy_store_init(&enemies, &current_level_map)
+            || !enemy_store_reserve(&enemies, current_level_map.enemy_spawn_count)) {
+        printf("Error: Could not allocate the enemies\n");
+        // Frees whatever was built so far, a half set up store included
+        game_unload();
+        return false;
+    }
+    for (int i = 0; i < current_level_map.enemy_count; ++i) {
+        if (current_level_map.enemies[i].spawn_count == 0) {
+            printf("Warning: Enemy '%s' was defined but not placed on the map.\n", current_level_map.enemies[i].id);
+        }
+    }
+    for (int i = 0; i < current_level_map.enemy_spawn_count; ++i) {
+        const EnemySpawn* spawn = &current_level_map.enemy_spawns[i];
+        // Consecutive seeds are fine, rng_seed spreads them apart
+        enemy_spawn(&enemies, spawn->data, spawn->pos, seed + i);
+    }
+    printf("Spawned %d enemies of %d types\n", enemies.count, enemies.config_count);
+
+    active_npc_count = 0;
+    npcs = (NPC*)calloc(current_level_map.npc_count > 0 ? current_level_map.npc_count : 1, sizeof(NPC));
+    for (int i = 0; npcs && i < current_level_map.npc_count; ++i) {
+        if (current_level_map.npcs[i].has_spawned) {
+            printf("Spawning NPC: %s\n", current_level_map.npcs[i].id);
+            npc_create(&npcs[active_npc_count++], &current_level_map.npcs[i]);
+        } else {
+             printf("Warning: NPC '%s' was defined but not placed on the map.\n", current_level_map.npcs[i].id);
+        }
+    }
+    npc_grid = spatial_grid_create(&current_level_map, SPATIAL_GRID_CELL_TILES);
+    if (npc_grid && spatial_grid_reserve(npc_grid, active_npc_count)) {
+        for (int i = 0; i < active_npc_count; ++i) {
+            Vector2f npc_center = { npcs[i].rect.x + npcs[i].rect.w / 2.0f, npcs[i].rect.y + npcs[i].rect.h / 2.0f };
+            spatial_grid_insert(npc_grid, i, npc_center);
+        }
+    }
+
+    current_game_state = GAME_STATE_PLAYING;
+    camera_update(&camera, &player, &current_level_map, 2.5);
+    previous_camera = camera;
+    return true;
+}
+
+static void game_interact();
+
+void game_tick(const bool* keyboard_state, uint32_t actions) {
+    TRACE_BEGIN("update");
+    // The path workers get a new expansion budget every tick
+    if (current_level_map.path_jobs) {
+        pathjobs_begin_tick(current_level_map.path_jobs);
+    }
+    if (actions & GAME_ACTION_INTERACT) {
+        if (dialogue_is_active()) {
+            dialogue_advance();
+        } else {
+            game_interact();
+        }
+    }
+    if (actions & GAME_ACTION_PAUSE) {
+        if (current_game_state != GAME_STATE_PAUSE){
+            current_game_state = GAME_STATE_PAUSE;
+        } else if (current_game_state == GAME_STATE_PAUSE){
+            current_game_state = GAME_STATE_PLAYING;
+        }
+    }
+
+    // Rendering blends from where everything was before this tick
+    player.previous_rect = player.rect;
+    if (enemies.count > 0) {
+        memcpy(enemies.previous_rect, enemies.rect, enemies.count * sizeof(SDL_FRect));
+    }
+    previous_camera = camera;
+
+    if (dialogue_is_active()) {
+        current_game_state = GAME_STATE_DIALOGUE;
+    } else if (current_game_state == GAME_STATE_DIALOGUE) {
+        // This check prevents us from getting stuck in the dialogue state
+        // after a conversation ends.
+        current_game_state = GAME_STATE_PLAYING;
+    }
+
+    switch (current_game_state) {
+        case GAME_STATE_PLAYING:
+        {
+            PROFILE_BEGIN(PROFILE_ZONE_PLAYER);
+            player_update(&player, keyboard_state, &current_level_map);
+            PROFILE_END(PROFILE_ZONE_PLAYER);
+            // Only rebuilds when the player steps onto another tile
+            if (current_level_map.player_flow) {
+                PROFILE_BEGIN(PROFILE_ZONE_FLOWFIELD);
+                flowfield_update(current_level_map.player_flow, &current_level_map, (Vector2f){ player.rect.x, player.rect.y });
+                PROFILE_END(PROFILE_ZONE_FLOWFIELD);
+            }
+            if (current_level_map.player_visibility) {
+                PROFILE_BEGIN(PROFILE_ZONE_VISIBILITY);
+                visibility_update(current_level_map.player_visibility, &current_level_map, (Vector2f){ player.rect.x, player.rect.y });
+                PROFILE_END(PROFILE_ZONE_VISIBILITY);
+            }
+            PROFILE_BEGIN(PROFILE_ZONE_ENEMIES);
+            enemy_store_update(&enemies, enemy_jobs, &player, &current_level_map);
+            PROFILE_END(PROFILE_ZONE_ENEMIES);
+            break;
+        }
+        case GAME_STATE_DIALOGUE:
+            dialogue_update();
+            break;
+        case GAME_STATE_PAUSE:
+            break;
+    }
+
+    camera_update(&camera, &player, &current_level_map, 2.5);
+    TRACE_END("update");
+}
+
+#define INTERACT_REACH 50.0f
+// NPC markers take two tiles of a row, fewer than this ever fit in reach
+#define INTERACT_MAX_NPCS 32
+
+static int compare_ints(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+/// Starts a conversation with the first NPC in reach and in sight of the player
+static void game_interact() {
+    if (!npc_grid) return;
+    Vector2f player_center = { player.rect.x + player.rect.w / 2.0f, player.rect.y + player.rect.h / 2.0f };
+
+    // Only the cells around the player are looked at. Sorting keeps the
+    // lowest index first, whatever cells the NPCs are in
+    int npc_indices[INTERACT_MAX_NPCS];
+    int in_reach = spatial_grid_query_radius(npc_grid, player_center, INTERACT_REACH, npc_indices, INTERACT_MAX_NPCS);
+    if (in_reach > INTERACT_MAX_NPCS) in_reach = INTERACT_MAX_NPCS;
+    qsort(npc_indices, in_reach, sizeof(int), compare_ints);
+
+    // Tests them all in one LOS batch
+    Vector2f npc_centers[INTERACT_MAX_NPCS];
+    bool npc_visible[INTERACT_MAX_NPCS];
+    for (int i = 0; i < in_reach; ++i) {
+        const NPC* npc = &npcs[npc_indices[i]];
+        npc_centers[i] = (Vector2f){ npc->rect.x + npc->rect.w / 2.0f, npc->rect.y + npc->rect.h / 2.0f };
+    }
+    map_has_line_of_sight_batch(&current_level_map, player_center, npc_centers, in_reach, npc_visible);
+    for (int i = 0; i < in_reach; ++i) {
+        if (npc_visible[i]) {
+            NPC* npc = &npcs[npc_indices[i]];
+            dialogue_start_conversation(npc->dialogue_lines, npc->dialogue_line_count);
+            break;
+        }
+    }
+}
+
+// FNV-1a over the raw bytes
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t game_state_hash() {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = hash_bytes(hash, &player.rect, sizeof(player.rect));
+    hash = hash_bytes(hash, &player.vel, sizeof(player.vel));
+    hash = hash_bytes(hash, &current_game_state, sizeof(current_game_state));
+    for (int i = 0; i < enemies.count; ++i) {
+        hash = hash_bytes(hash, &enemies.rect[i], sizeof(enemies.rect[i]));
+        hash = hash_bytes(hash, &enemies.vel[i], sizeof(enemies.vel[i]));
+        hash = hash_bytes(hash, &enemies.state[i], sizeof(enemies.state[i]));
+        hash = hash_bytes(hash, &enemies.rng[i], sizeof(enemies.rng[i]));
+    }
+    return hash;
+}
+
+void game_unload() {
+    dialogue_end_conversation();
+    // --- Memory Cleanup ---
+    // Call the destroy function for each NPC to free the dialogue memory.
+    for (int i = 0; i < active_npc_count; ++i) {
+        npc_destroy(&npcs[i]);
+    }
+    free(npcs);
+    npcs = NULL;
+    spatial_grid_destroy(npc_grid);
+    npc_grid = NULL;
+    active_npc_count = 0;
+    enemy_store_destroy(&enemies);
+    jobs_destroy(enemy_jobs);
+    enemy_jobs = NULL;
+    // Workers go first, they read the navigation data below
+    pathjobs_destroy(current_level_map.path_jobs);
+    current_level_map.path_jobs = NULL;
+    pathfinding_context_destroy(current_level_map.pathfinding);
+    current_level_map.pathfinding = NULL;
+    hpa_destroy(current_level_map.hierarchy);
+    current_level_map.hierarchy = NULL;
+    flowfield_destroy(current_level_map.player_flow);
+    current_level_map.player_flow = NULL;
+    visibility_destroy(current_level_map.player_visibility);
+    current_level_map.player_visibility = NULL;
+    map_cache_destroy(current_level_map.render_cache);
+    current_level_map.render_cache = NULL;
+    map_destroy(&current_level_map);
+}
@@ -1,13 +1,66 @@
 #ifndef GAME_H
 #define GAME_H
 
+/// The game world and its simulation step, with no window or renderer
+/// attached. main.c drives it from the SDL callbacks, headless.c runs it
+/// without a display to measure how fast the simulation goes.
+/// This is the top of the include order, nothing else includes it
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../map/map.h"
+#include "../player/player.h"
+#include "../enemies/enemy.h"
+#include "../npc/npc.h"
+#include "../camera/camera.h"
+
 typedef enum {
     GAME_STATE_PLAYING,
     GAME_STATE_DIALOGUE,
     GAME_STATE_PAUSE
 } GameState;
 
+/// One shot inputs, they arrive as key presses and are handed to the next tick
+/// so a replay can feed them back on the same tick
+#define GAME_ACTION_INTERACT (1u << 0) // Talk to an NPC or advance the dialogue
+#define GAME_ACTION_PAUSE    (1u << 1) // Toggle the pause menu
+
+// Seed for runs that don't ask for one and still need to be reproducible
+#define GAME_DEFAULT_SEED 1
+
+// game_enemy_workers value that takes one worker per spare core
+#define GAME_WORKERS_AUTO -1
+
 // A global variable to hold the current game state
 extern GameState current_game_state;
 
+// The loaded level and everything living in it
+extern Map current_level_map;
+extern Player player;
+extern EnemyStore enemies;
+extern NPC* npcs;            // The NPCs placed on the map, active_npc_count of them
+extern int active_npc_count;
+extern Camera camera;
+extern Camera previous_camera; // camera at the start of the last tick
+
+// Threads helping the main thread think for the enemies, read by game_load.
+// 0 keeps the whole update on the main thread, the runs are the same either way
+extern int game_enemy_workers;
+
+/// Loads a level, builds its navigation data and spawns the player, enemies
+/// and NPCs. renderer can be NULL, the level then has no render cache.
+/// seed drives every random decision. With deterministic set, path searches
+/// are delivered on a fixed tick too, so the same seed and input always give
+/// the same run. Returns false if the level could not be loaded
+bool game_load(const char* level_path, SDL_Renderer* renderer, uint64_t seed, bool deterministic);
+/// Advances the game by one fixed TICK_NS step. keyboard_state is indexed by
+/// SDL_Scancode, like SDL_GetKeyboardState, actions is a GAME_ACTION_* mask
+void game_tick(const bool* keyboard_state, uint32_t actions);
+/// Hash of the player and enemy state, equal hashes after the same number of
+/// ticks mean two runs went the same way
+uint64_t game_state_hash();
+/// Frees everything game_load created
+void game_unload();
+
 #endif // GAME_H
@@ -0,0 +1,113 @@
+// stalker-c/game/replay.c
+
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The keys the simulation reads from the keyboard state, a key missing here
+// is silently dropped from recordings. Appending changes the file format, bump
+// REPLAY_VERSION when doing so
+static const SDL_Scancode replay_keys[] = {
+    SDL_SCANCODE_W,
+    SDL_SCANCODE_A,
+    SDL_SCANCODE_S,
+    SDL_SCANCODE_D,
+    SDL_SCANCODE_LSHIFT,
+};
+#define REPLAY_KEY_COUNT (int)(sizeof(replay_keys) / sizeof(replay_keys[0]))
+
+struct Replay {
+    FILE* file;
+    bool recording;
+    ReplayHeader header;
+    long ticks;
+};
+
+Replay* replay_record_open(const char* path, const char* level_path, uint64_t seed) {
+    Replay* replay = (Replay*)calloc(1, sizeof(Replay));
+    if (!replay) return NULL;
+
+    replay->file = fopen(path, "wb");
+    if (!replay->file) {
+        printf("Error: Could not create replay file %s\n", path);
+        free(replay);
+        return NULL;
+    }
+    replay->recording = true;
+    memcpy(replay->header.magic, REPLAY_MAGIC, sizeof(replay->header.magic));
+    replay->header.version = REPLAY_VERSION;
+    replay->header.key_count = REPLAY_KEY_COUNT;
+    replay->header.seed = seed;
+    snprintf(replay->header.level_path, sizeof(replay->header.level_path), "%s", level_path);
+
+    if (fwrite(&replay->header, sizeof(ReplayHeader), 1, replay->file) != 1) {
+        printf("Error: Could not write replay file %s\n", path);
+        fclose(replay->file);
+        free(replay);
+        return NULL;
+    }
+    return replay;
+}
+
+void replay_record_tick(Replay* replay, const bool* keyboard_state, uint32_t actions) {
+    uint32_t input = actions << 16;
+    for (int i = 0; i < REPLAY_KEY_COUNT; i++) {
+        if (keyboard_state[replay_keys[i]]) input |= 1u << i;
+    }
+    fwrite(&input, sizeof(input), 1, replay->file);
+    replay->ticks++;
+}
+
+Replay* replay_play_open(const char* path) {
+    Replay* replay = (Replay*)calloc(1, sizeof(Replay));
+    if (!replay) return NULL;
+
+    replay->file = fopen(path, "rb");
+    if (!replay->file) {
+        printf("Error: Could not open replay file %s\n", path);
+        free(replay);
+        return NULL;
+    }
+    if (fread(&replay->header, sizeof(ReplayHeader), 1, replay->file) != 1 ||
+        memcmp(replay->header.magic, REPLAY_MAGIC, sizeof(replay->header.magic)) != 0 ||
+        replay->header.version != REPLAY_VERSION ||
+        replay->header.key_count != REPLAY_KEY_COUNT) {
+        printf("Error: %s is not a replay this version can play\n", path);
+        fclose(replay->file);
+        free(replay);
+        return NULL;
+    }
+    replay->header.level_path[REPLAY_LEVEL_PATH_LENGTH - 1] = '\0';
+    return replay;
+}
+
+bool replay_play_tick(Replay* replay, bool* keyboard_state, uint32_t* actions) {
+    uint32_t input = 0;
+    if (fread(&input, sizeof(input), 1, replay->file) != 1) return false;
+
+    for (int i = 0; i < REPLAY_KEY_COUNT; i++) {
+        keyboard_state[replay_keys[i]] = (input >> i) & 1;
+    }
+    *actions = input >> 16;
+    replay->ticks++;
+    return true;
+}
+
+const char* replay_level_path(const Replay* replay) {
+    return replay->header.level_path;
+}
+
+uint64_t replay_seed(const Replay* replay) {
+    return replay->header.seed;
+}
+
+long replay_tick_count(const Replay* replay) {
+    return replay->ticks;
+}
+
+void replay_close(Replay* replay) {
+    if (!replay) return;
+    fclose(replay->file);
+    free(replay);
+}
@@ -0,0 +1,52 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/// Input recording and playback
+/// A replay file holds the level and RNG seed a run started with, then the
+/// input of every tick: the held keys the game reads from the keyboard state
+/// and the one shot actions (GAME_ACTION_*) that came in as key presses.
+/// Loading the same level with the same seed and feeding the ticks back gives
+/// the same run, see game_load's deterministic flag.
+///
+/// Layout, little endian as written by the host:
+///   ReplayHeader
+///   uint32_t per tick, the low 16 bits are held keys in replay_keys order,
+///   the high 16 bits are the actions
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define REPLAY_MAGIC "STLKRPL"
+#define REPLAY_VERSION 1
+#define REPLAY_LEVEL_PATH_LENGTH 256
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t key_count; // Must match the build reading it
+    uint64_t seed;
+    char level_path[REPLAY_LEVEL_PATH_LENGTH];
+} ReplayHeader;
+
+typedef struct Replay Replay;
+
+// Starts a new file, the header is written straight away
+Replay* replay_record_open(const char* path, const char* level_path, uint64_t seed);
+void replay_record_tick(Replay* replay, const bool* keyboard_state, uint32_t actions);
+
+// Opens a recording for playback, NULL if it can't be read or is from another version
+Replay* replay_play_open(const char* path);
+// Fills keyboard_state (indexed by SDL_Scancode) and actions with the next
+// tick. Returns false once every tick has been played
+bool replay_play_tick(Replay* replay, bool* keyboard_state, uint32_t* actions);
+
+const char* replay_level_path(const Replay* replay);
+uint64_t replay_seed(const Replay* replay);
+// Ticks recorded or played so far
+long replay_tick_count(const Replay* replay);
+
+// Flushes a recording, closes either kind
+void replay_close(Replay* replay);
+
+#endif // REPLAY_H
@@ -0,0 +1,207 @@
+// stalker-c/headless.c
+// Runs the game simulation without a window, renderer or frame limiter and
+// reports how many ticks per second it manages. The level is loaded and
+// populated exactly like the windowed game does it (see game/game.c), the
+// player is driven by a fixed input script or by a recording made with
+// --record (here or in the game). Runs are always deterministic, the final
+// state hash is the same for the same level, seed, input and tick count
+//
+// Build (from the repository root):
+//   cc -O2 -o headless headless.c game/game.c map/*.c player/player.c
+//      enemies/enemy.c npc/npc.c camera/camera.c dialogue/dialogue.c
+//      game/replay.c text/text.c helper/*.c
+//      $(pkg-config --cflags --libs sdl3 sdl3-ttf) -lm
+// Usage:
+//   ./headless [--seed N] [--enemy-workers N] [--record file] [--replay file]
+//              [--trace file] [level_file] [ticks]
+// A replay sets the level and seed, and by default runs for as many ticks as
+// were recorded
+
+#include <SDL3/SDL.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defs/defs.h"
+#include "game/game.h"
+#include "game/replay.h"
+#include "helper/pathjobs.h"
+#include "helper/profiler.h"
+#include "helper/trace.h"
+
+#define HEADLESS_DEFAULT_TICKS 10000
+#define SCRIPT_STEP_TICKS 90 // How long the player keeps each input
+
+// Input script, the player walks a loop and runs every other lap so both
+// movement speeds and the noise they make get exercised
+static void scripted_input(bool* keyboard_state, long tick) {
+    static const SDL_Scancode directions[] = { SDL_SCANCODE_D, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_W };
+    const long step = tick / SCRIPT_STEP_TICKS;
+
+    keyboard_state[SDL_SCANCODE_W] = false;
+    keyboard_state[SDL_SCANCODE_A] = false;
+    keyboard_state[SDL_SCANCODE_S] = false;
+    keyboard_state[SDL_SCANCODE_D] = false;
+    keyboard_state[directions[step % 4]] = true;
+    keyboard_state[SDL_SCANCODE_LSHIFT] = (step / 4) % 2 == 1;
+}
+
+static void usage(const char* program) {
+    printf("usage: %s [--seed N] [--enemy-workers N] [--record file] [--replay file] [--trace file] [level_file] [ticks]\n", program);
+}
+
+int main(int argc, char** argv) {
+    const char* level_path = NULL;
+    long ticks = 0;
+    uint64_t seed = GAME_DEFAULT_SEED;
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    const char* trace_path = NULL;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            if (strcmp(argv[i], "--seed") == 0) {
+                seed = strtoull(argv[++i], NULL, 10);
+            } else if (strcmp(argv[i], "--enemy-workers") == 0) {
+                game_enemy_workers = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "--record") == 0) {
+                record_path = argv[++i];
+            } else if (strcmp(argv[i], "--replay") == 0) {
+                replay_path = argv[++i];
+            } else if (strcmp(argv[i], "--trace") == 0) {
+                trace_path = argv[++i];
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (positional == 0) {
+            level_path = argv[i];
+            positional++;
+        } else if (positional == 1) {
+            ticks = atol(argv[i]);
+            positional++;
+            if (ticks <= 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+
+    Replay* playback = NULL;
+    if (replay_path) {
+        playback = replay_play_open(replay_path);
+        if (!playback) return 1;
+        if (!level_path) level_path = replay_level_path(playback);
+        seed = replay_seed(playback);
+    }
+    if (!level_path) level_path = "level.txt";
+    // Without a tick count a replay runs to its end
+    if (ticks == 0) ticks = playback ? LONG_MAX : HEADLESS_DEFAULT_TICKS;
+
+    if (!SDL_Init(0)) {
+        printf("[HEADLESS] Couldn't initialize SDL: %s\n", SDL_GetError());
+        replay_close(playback);
+        return 1;
+    }
+
+    const Uint64 load_start = SDL_GetTicksNS();
+    if (!game_load(level_path, NULL, seed, true)) {
+        printf("[HEADLESS] Could not load %s\n", level_path);
+        replay_close(playback);
+        SDL_Quit();
+        return 1;
+    }
+    const Uint64 load_ns = SDL_GetTicksNS() - load_start;
+    Replay* recording = record_path ? replay_record_open(record_path, level_path, seed) : NULL;
+    // Only the ticks are traced, not the load
+    trace_name_thread("main");
+    if (trace_path) trace_start(trace_path);
+
+    static bool keyboard_state[SDL_SCANCODE_COUNT];
+    long tick = 0;
+    // Enemy updates the scheduler ran and put off, over the ticks the enemies ran
+    long long enemy_thinks = 0;
+    long long enemy_deferred = 0;
+    long long enemy_over_budget = 0;
+    int enemy_ticks = 0;
+    // Path expansions the workers were charged, each tick counts the one before
+    long long path_expanded = 0;
+    int path_expanded_max = 0;
+    const Uint64 start = SDL_GetTicksNS();
+    for (; tick < ticks; ++tick) {
+        uint32_t actions = 0;
+        if (playback) {
+            if (!replay_play_tick(playback, keyboard_state, &actions)) break;
+        } else {
+            scripted_input(keyboard_state, tick);
+        }
+        if (recording) replay_record_tick(recording, keyboard_state, actions);
+        // Every tick is a profiler frame here
+        PROFILE_BEGIN(PROFILE_ZONE_FRAME);
+        game_tick(keyboard_state, actions);
+        PROFILE_END(PROFILE_ZONE_FRAME);
+        profiler_frame_end();
+        if (current_level_map.path_jobs && tick > 0) {
+            const int expanded = pathjobs_tick_expansions(current_level_map.path_jobs);
+            path_expanded += expanded;
+            path_expanded_max = SDL_max(path_expanded_max, expanded);
+        }
+        if (enemies.tick != enemy_ticks) {
+            enemy_ticks = enemies.tick;
+            enemy_thinks += enemies.thinking;
+            enemy_deferred += enemies.deferred;
+            enemy_over_budget += enemies.over_budget;
+        }
+    }
+    const Uint64 elapsed_ns = SDL_GetTicksNS() - start;
+    trace_stop();
+    ticks = tick;
+    if (ticks == 0) {
+        printf("[HEADLESS] No ticks were run\n");
+        replay_close(recording);
+        replay_close(playback);
+        game_unload();
+        SDL_Quit();
+        return 1;
+    }
+
+    const double seconds = elapsed_ns / 1e9;
+    printf("level        %s (%dx%d, %d enemies, %d npcs)\n", level_path,
+           current_level_map.width, current_level_map.height, enemies.count, active_npc_count);
+    printf("seed         %llu%s\n", (unsigned long long)seed, playback ? " (replay)" : "");
+    printf("load         %.2f ms\n", load_ns / 1e6);
+    printf("ticks        %ld in %.3f s\n", ticks, seconds);
+    printf("ticks/sec    %.0f (%.1fx real time at %d Hz)\n", ticks / seconds, ticks / seconds / TICK_RATE, TICK_RATE);
+    printf("us/tick      %.2f\n", elapsed_ns / 1e3 / ticks);
+    printf("state hash   %016llx\n", (unsigned long long)game_state_hash());
+    if (enemy_ticks > 0) {
+        printf("enemy thinks %.1f per tick, %.1f deferred (%.1f over budget)\n",
+               (double)enemy_thinks / enemy_ticks, (double)enemy_deferred / enemy_ticks,
+               (double)enemy_over_budget / enemy_ticks);
+    }
+    if (current_level_map.path_jobs && ticks > 1) {
+        printf("path search  %.0f expansions per tick, %d at most (budget %d)\n",
+               (double)path_expanded / (ticks - 1), path_expanded_max, PATH_EXPANSIONS_PER_TICK);
+    }
+
+#if PROFILING
+    // Zones over the last PROFILER_HISTORY ticks, the render ones stay empty
+    printf("\nzone (last %d ticks)   avg ms    p99 ms\n", PROFILER_HISTORY);
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        ProfileStats stats;
+        profiler_get_stats((ProfileZone)zone, &stats);
+        if (stats.p99_ms == 0.0f) continue;
+        printf("%-20s %8.4f  %8.4f\n", profiler_zone_name((ProfileZone)zone), stats.average_ms, stats.p99_ms);
+    }
+#endif
+
+    replay_close(recording);
+    replay_close(playback);
+    game_unload();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,202 @@
+// stalker-c/helper/flowfield.c
+
+#include "flowfield.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+static const int step_dx[4] = { -1, 0, 0, 1 };
+static const int step_dy[4] = { 0, -1, 1, 0 };
+
+static void heap_swap(FlowField* field, int a, int b) {
+    int temp = field->heap[a];
+    field->heap[a] = field->heap[b];
+    field->heap[b] = temp;
+    field->heap_index[field->heap[a]] = a;
+    field->heap_index[field->heap[b]] = b;
+}
+
+static void heapify_up(FlowField* field, int index) {
+    while (index > 0) {
+        int parent_index = (index - 1) / 2;
+        if (field->dist[field->heap[index]] >= field->dist[field->heap[parent_index]]) break;
+        heap_swap(field, index, parent_index);
+        index = parent_index;
+    }
+}
+
+static void heapify_down(FlowField* field, int index) {
+    while (1) {
+        int left = 2 * index + 1;
+        int right = 2 * index + 2;
+        int smallest = index;
+        if (left < field->heap_count && field->dist[field->heap[left]] < field->dist[field->heap[smallest]]) smallest = left;
+        if (right < field->heap_count && field->dist[field->heap[right]] < field->dist[field->heap[smallest]]) smallest = right;
+        if (smallest == index) break;
+        heap_swap(field, index, smallest);
+        index = smallest;
+    }
+}
+
+static int heap_pop(FlowField* field) {
+    int top = field->heap[0];
+    field->heap_count--;
+    if (field->heap_count > 0) {
+        field->heap[0] = field->heap[field->heap_count];
+        field->heap_index[field->heap[0]] = 0;
+        heapify_down(field, 0);
+    }
+    field->heap_index[top] = -1;
+    return top;
+}
+
+FlowField* flowfield_create(const Map* map, int radius) {
+    FlowField* field = (FlowField*)calloc(1, sizeof(FlowField));
+    if (!field) return NULL;
+
+    if (radius < FLOWFIELD_MIN_RADIUS) radius = FLOWFIELD_MIN_RADIUS;
+    field->width = map->width;
+    field->height = map->height;
+    field->root_x = -1;
+    field->root_y = -1;
+    field->radius = radius;
+    field->window = 2 * radius + 1;
+    const size_t tiles = (size_t)field->window * field->window;
+    field->dist = (uint32_t*)malloc(tiles * sizeof(uint32_t));
+    field->step = (uint8_t*)malloc(tiles);
+    field->stamp = (uint32_t*)calloc(tiles, sizeof(uint32_t));
+    field->heap = (int*)malloc(tiles * sizeof(int));
+    field->heap_index = (int*)malloc(tiles * sizeof(int));
+
+    if (!field->dist || !field->step || !field->stamp || !field->heap || !field->heap_index) {
+        printf("Error: Could not allocate the flow field\n");
+        flowfield_destroy(field);
+        return NULL;
+    }
+    return field;
+}
+
+void flowfield_destroy(FlowField* field) {
+    if (field) {
+        free(field->dist);
+        free(field->step);
+        free(field->stamp);
+        free(field->heap);
+        free(field->heap_index);
+        free(field);
+    }
+}
+
+/// Reverse Dijkstra from the root over map->cost_field, kept to the square
+/// within radius of the root
+/// Walking from a tile into its neighbour costs the neighbour's cost, the same
+/// rule the A* uses, so the field and the searches agree on the best route.
+/// A route that has to leave the square to get around a wall isn't found,
+/// enemies behind such a wall get no step and search instead.
+/// The heap and the arrays work on indices into the square
+static void flowfield_build(FlowField* field, const Map* map) {
+    const int window = field->window;
+    if (++field->generation == 0) {
+        for (int i = 0; i < window * window; i++) field->stamp[i] = 0;
+        field->generation = 1;
+    }
+    field->heap_count = 0;
+    field->rebuild_count++;
+
+    // Map tile of the corner of the square, and the part of it on the map
+    const int corner_x = field->root_x - field->radius;
+    const int corner_y = field->root_y - field->radius;
+    const int min_x = SDL_max(-corner_x, 0);
+    const int max_x = SDL_min(field->width - 1 - corner_x, window - 1);
+    const int min_y = SDL_max(-corner_y, 0);
+    const int max_y = SDL_min(field->height - 1 - corner_y, window - 1);
+
+    int root = field->radius * window + field->radius;
+    field->stamp[root] = field->generation;
+    field->dist[root] = 0;
+    field->step[root] = FLOWFIELD_NO_STEP;
+    field->heap[field->heap_count] = root;
+    field->heap_index[root] = field->heap_count++;
+
+    while (field->heap_count > 0) {
+        int current = heap_pop(field);
+        int cx = current % window;
+        int cy = current / window;
+        // Neighbours pay the cost of stepping into this tile. Only the root can
+        // have a cost of 0 (the player clipping a wall), it still costs 1
+        uint32_t enter_cost = map->cost_field[(corner_y + cy) * map->width + corner_x + cx];
+        uint32_t candidate = field->dist[current] + (enter_cost ? enter_cost : 1);
+
+        for (int d = 0; d < 4; d++) {
+            int nx = cx + step_dx[d];
+            int ny = cy + step_dy[d];
+            if (nx < min_x || nx > max_x || ny < min_y || ny > max_y) continue;
+
+            int neighbor = ny * window + nx;
+            if (map->cost_field[(corner_y + ny) * map->width + corner_x + nx] == 0) continue;
+
+            if (field->stamp[neighbor] != field->generation) {
+                field->stamp[neighbor] = field->generation;
+                field->heap_index[neighbor] = -1;
+            } else if (candidate >= field->dist[neighbor]) {
+                continue;
+            }
+
+            field->dist[neighbor] = candidate;
+            // The neighbour reaches the root through us, which lies in the
+            // opposite direction of the one we used to get to it
+            field->step[neighbor] = (uint8_t)(3 - d);
+            if (field->heap_index[neighbor] < 0) {
+                field->heap[field->heap_count] = neighbor;
+                field->heap_index[neighbor] = field->heap_count++;
+            }
+            heapify_up(field, field->heap_index[neighbor]);
+        }
+    }
+}
+
+bool flowfield_update(FlowField* field, const Map* map, Vector2f target_pos) {
+    int x = target_pos.x / TILE_SIZE;
+    int y = target_pos.y / TILE_SIZE;
+    if (x < 0 || x >= field->width || y < 0 || y >= field->height) return false;
+    if (x == field->root_x && y == field->root_y) return false;
+
+    field->root_x = x;
+    field->root_y = y;
+    flowfield_build(field, map);
+    return true;
+}
+
+bool flowfield_targets(const FlowField* field, Vector2f target_pos) {
+    return field->root_x >= 0
+        && (int)(target_pos.x / TILE_SIZE) == field->root_x
+        && (int)(target_pos.y / TILE_SIZE) == field->root_y;
+}
+
+bool flowfield_next_step(const FlowField* field, Vector2f pos, Vector2f* next) {
+    int x = pos.x / TILE_SIZE;
+    int y = pos.y / TILE_SIZE;
+    if (field->root_x < 0 || x < 0 || x >= field->width || y < 0 || y >= field->height) return false;
+
+    // Steps that are already within half a tile are skipped, the same rule the
+    // path follower uses. Without it an enemy sitting right on a tile border
+    // flips between the two tiles every tick
+    for (int hops = 0; hops < 4; hops++) {
+        // Tiles outside the square have no step
+        int local_x = x - field->root_x + field->radius;
+        int local_y = y - field->root_y + field->radius;
+        if (local_x < 0 || local_x >= field->window || local_y < 0 || local_y >= field->window) {
+            return hops > 0;
+        }
+        int index = local_y * field->window + local_x;
+        if (field->stamp[index] != field->generation || field->step[index] == FLOWFIELD_NO_STEP) {
+            return hops > 0;
+        }
+
+        x += step_dx[field->step[index]];
+        y += step_dy[field->step[index]];
+        next->x = x * TILE_SIZE;
+        next->y = y * TILE_SIZE;
+        if (vector_magnitude(vector_subtract(*next, pos)) >= TILE_SIZE / 2.0f) break;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+/// Flow field toward a single target tile (the player)
+/// One reverse Dijkstra from the target fills in, for every tile around it,
+/// the cost to reach the target and which neighbour to step to next. Any
+/// number of enemies chasing that target can then read their next step in
+/// O(1) instead of running their own search.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../map/map.h"
+#include "vector.h"
+
+// The field only covers the square of tiles within radius of the target, a
+// rebuild costs that square and the arrays hold that square, whatever the
+// size of the map. Enemies outside it
+// fall back to A*. Stalkers only follow the field once they sensed the player,
+// game_load sizes it to the furthest the level's enemies can do that from
+#define FLOWFIELD_MIN_RADIUS 16
+
+#define FLOWFIELD_NO_STEP 0xff
+
+typedef struct FlowField {
+    int width;
+    int height;
+    int root_x;          // Target tile, -1 before the first build
+    int root_y;
+    int radius;          // Tiles, the field spans 2 * radius + 1 per side
+    int window;          // 2 * radius + 1, the arrays below are window * window
+    // Indexed by the tile relative to the corner of the square, root - radius
+    uint32_t* dist;      // Cost from each tile to the target
+    uint8_t* step;       // Direction of the next tile, FLOWFIELD_NO_STEP if none
+    uint32_t* stamp;     // Tiles are only valid when stamp == generation
+    uint32_t generation;
+    int* heap;
+    int* heap_index;
+    int heap_count;
+    int rebuild_count;   // How many times the field was rebuilt, for profiling
+} FlowField;
+
+FlowField* flowfield_create(const Map* map, int radius);
+void flowfield_destroy(FlowField* field);
+
+// Moves the target to the tile under target_pos, rebuilding only if that tile
+// changed. Returns true when a rebuild happened
+bool flowfield_update(FlowField* field, const Map* map, Vector2f target_pos);
+
+// True when target_pos lies on the tile the field currently leads to
+bool flowfield_targets(const FlowField* field, Vector2f target_pos);
+
+// Writes the world position of the next tile to walk to from pos
+// Returns false if pos is on the target tile or outside the field
+// Cost is constant, at most a few lookups along the field
+bool flowfield_next_step(const FlowField* field, Vector2f pos, Vector2f* next);
+
+#endif // FLOWFIELD_H
@@ -0,0 +1,678 @@
+// stalker-c/helper/hpa.c
+
+#include "hpa.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <stdio.h>
+
+// Openings narrower than this get one transition in the middle, wider ones get
+// one at each end, same rule as the original HPA* paper
+#define HPA_MAX_ENTRANCE_WIDTH 6
+
+#define UNREACHED INT_MAX
+
+typedef struct {
+    int target;
+    int cost;
+} HpaEdge;
+
+typedef struct {
+    int x, y;
+    int cluster;
+    int first_edge;
+    int edge_count;
+} HpaNode;
+
+struct PathHierarchy {
+    int width;
+    int height;
+    int cluster_size;
+    int clusters_x;
+    int clusters_y;
+    HpaNode* nodes;       // Sorted by cluster
+    int node_count;
+    HpaEdge* edges;       // Outgoing edges of every node, packed by source
+    int edge_count;
+    int* cluster_first_node; // Cluster c owns nodes [first[c], first[c + 1])
+    int max_cluster_nodes;
+};
+
+/// Dijkstra restricted to one cluster, indices are local to the cluster
+typedef struct {
+    int* dist;
+    int* parent;
+    int* heap;
+    int* heap_index;
+    int heap_count;
+    int* trace;
+    int expanded; // Tiles settled since the counter was last reset
+    // Bounds of the cluster being searched
+    int x0, y0, w, h;
+} ClusterSearch;
+
+typedef struct {
+    int g_score;
+    int f_score;
+    int parent;
+    int heap_index;
+    uint32_t generation;
+} AbstractNode;
+
+struct HpaWorkspace {
+    ClusterSearch local;
+    AbstractNode* nodes;  // node_count real nodes, then the start and the goal
+    int* heap;
+    int heap_count;
+    uint32_t generation;
+    int* start_node;      // Temporary edges out of the start tile
+    int* start_cost;
+    int start_edge_count;
+    int* goal_cost;       // Cost from each node of the goal cluster to the goal
+    int* route;
+    int expanded;         // Abstract nodes expanded by the last query
+};
+
+// -----------------------------------------------------------------------------
+// Cluster local search
+// -----------------------------------------------------------------------------
+
+static bool cluster_search_init(ClusterSearch* cs, int cluster_size) {
+    size_t n = (size_t)cluster_size * cluster_size;
+    cs->dist = (int*)malloc(n * sizeof(int));
+    cs->parent = (int*)malloc(n * sizeof(int));
+    cs->heap = (int*)malloc(n * sizeof(int));
+    cs->heap_index = (int*)malloc(n * sizeof(int));
+    cs->trace = (int*)malloc(n * sizeof(int));
+    cs->heap_count = 0;
+    return cs->dist && cs->parent && cs->heap && cs->heap_index && cs->trace;
+}
+
+static void cluster_search_free(ClusterSearch* cs) {
+    free(cs->dist);
+    free(cs->parent);
+    free(cs->heap);
+    free(cs->heap_index);
+    free(cs->trace);
+}
+
+static void local_swap(ClusterSearch* cs, int a, int b) {
+    int temp = cs->heap[a];
+    cs->heap[a] = cs->heap[b];
+    cs->heap[b] = temp;
+    cs->heap_index[cs->heap[a]] = a;
+    cs->heap_index[cs->heap[b]] = b;
+}
+
+static void local_heapify_up(ClusterSearch* cs, int index) {
+    while (index > 0) {
+        int parent_index = (index - 1) / 2;
+        if (cs->dist[cs->heap[index]] >= cs->dist[cs->heap[parent_index]]) break;
+        local_swap(cs, index, parent_index);
+        index = parent_index;
+    }
+}
+
+static void local_heapify_down(ClusterSearch* cs, int index) {
+    while (1) {
+        int left = 2 * index + 1;
+        int right = 2 * index + 2;
+        int smallest = index;
+        if (left < cs->heap_count && cs->dist[cs->heap[left]] < cs->dist[cs->heap[smallest]]) smallest = left;
+        if (right < cs->heap_count && cs->dist[cs->heap[right]] < cs->dist[cs->heap[smallest]]) smallest = right;
+        if (smallest == index) break;
+        local_swap(cs, index, smallest);
+        index = smallest;
+    }
+}
+
+static int local_pop(ClusterSearch* cs) {
+    cs->expanded++;
+    int top = cs->heap[0];
+    cs->heap_count--;
+    if (cs->heap_count > 0) {
+        cs->heap[0] = cs->heap[cs->heap_count];
+        cs->heap_index[cs->heap[0]] = 0;
+        local_heapify_down(cs, 0);
+    }
+    cs->heap_index[top] = -1;
+    return top;
+}
+
+static void local_relax(ClusterSearch* cs, int index, int dist, int parent) {
+    if (dist >= cs->dist[index]) return;
+    cs->dist[index] = dist;
+    cs->parent[index] = parent;
+    if (cs->heap_index[index] < 0) {
+        cs->heap[cs->heap_count] = index;
+        cs->heap_index[index] = cs->heap_count;
+        cs->heap_count++;
+    }
+    local_heapify_up(cs, cs->heap_index[index]);
+}
+
+static int cluster_local_index(const ClusterSearch* cs, int x, int y) {
+    return (y - cs->y0) * cs->w + (x - cs->x0);
+}
+
+// Clusters on the right and bottom edges can be smaller than cluster_size
+static void cluster_set_bounds(ClusterSearch* cs, const PathHierarchy* h, int cluster) {
+    cs->x0 = (cluster % h->clusters_x) * h->cluster_size;
+    cs->y0 = (cluster / h->clusters_x) * h->cluster_size;
+    cs->w = h->width - cs->x0 < h->cluster_size ? h->width - cs->x0 : h->cluster_size;
+    cs->h = h->height - cs->y0 < h->cluster_size ? h->height - cs->y0 : h->cluster_size;
+}
+
+/// Runs Dijkstra from a tile over the walkable tiles of one cluster
+/// Forward: dist is the cost of walking from the source to each tile
+/// Reverse: dist is the cost of walking from each tile to the source
+/// Stops early once stop_local is settled, pass -1 to settle everything
+static void cluster_search(ClusterSearch* cs, const PathHierarchy* h, const Map* map,
+                           int cluster, int source_x, int source_y, bool reverse, int stop_local) {
+    cluster_set_bounds(cs, h, cluster);
+
+    for (int i = 0; i < cs->w * cs->h; i++) {
+        cs->dist[i] = UNREACHED;
+        cs->heap_index[i] = -1;
+    }
+    cs->heap_count = 0;
+    local_relax(cs, (source_y - cs->y0) * cs->w + (source_x - cs->x0), 0, -1);
+
+    static const int neighbor_dx[4] = { -1, 0, 0, 1 };
+    static const int neighbor_dy[4] = { 0, -1, 1, 0 };
+
+    while (cs->heap_count > 0) {
+        int current = local_pop(cs);
+        if (current == stop_local) return;
+
+        int lx = current % cs->w;
+        int ly = current / cs->w;
+        uint8_t current_cost = map->cost_field[(cs->y0 + ly) * map->width + cs->x0 + lx];
+
+        for (int n = 0; n < 4; n++) {
+            int nx = lx + neighbor_dx[n];
+            int ny = ly + neighbor_dy[n];
+            if (nx < 0 || nx >= cs->w || ny < 0 || ny >= cs->h) continue;
+
+            uint8_t neighbor_cost = map->cost_field[(cs->y0 + ny) * map->width + cs->x0 + nx];
+            if (neighbor_cost == 0) continue;
+
+            int step = reverse ? current_cost : neighbor_cost;
+            local_relax(cs, ny * cs->w + nx, cs->dist[current] + step, current);
+        }
+    }
+}
+
+static int cluster_of(const PathHierarchy* h, int x, int y) {
+    return (y / h->cluster_size) * h->clusters_x + (x / h->cluster_size);
+}
+
+// -----------------------------------------------------------------------------
+// Build
+// -----------------------------------------------------------------------------
+
+typedef struct {
+    int source;
+    int target;
+    int cost;
+} BuildEdge;
+
+typedef struct {
+    HpaNode* nodes;
+    int node_count;
+    int node_capacity;
+    BuildEdge* edges;
+    int edge_count;
+    int edge_capacity;
+    int* tile_node;  // Node id of every tile, -1 if it is not an entrance
+    bool failed;     // A node or an edge could not be added
+} HpaBuilder;
+
+static int builder_add_node(HpaBuilder* b, const PathHierarchy* h, int x, int y) {
+    int tile = y * h->width + x;
+    if (b->tile_node[tile] >= 0) return b->tile_node[tile];
+
+    if (b->node_count == b->node_capacity) {
+        int capacity = b->node_capacity ? b->node_capacity * 2 : 256;
+        HpaNode* nodes = (HpaNode*)realloc(b->nodes, capacity * sizeof(HpaNode));
+        if (!nodes) {
+            b->failed = true;
+            return -1;
+        }
+        b->nodes = nodes;
+        b->node_capacity = capacity;
+    }
+    HpaNode* node = &b->nodes[b->node_count];
+    node->x = x;
+    node->y = y;
+    node->cluster = cluster_of(h, x, y);
+    node->first_edge = 0;
+    node->edge_count = 0;
+    b->tile_node[tile] = b->node_count;
+    return b->node_count++;
+}
+
+static void builder_add_edge(HpaBuilder* b, int source, int target, int cost) {
+    if (b->edge_count == b->edge_capacity) {
+        int capacity = b->edge_capacity ? b->edge_capacity * 2 : 1024;
+        BuildEdge* edges = (BuildEdge*)realloc(b->edges, capacity * sizeof(BuildEdge));
+        if (!edges) {
+            b->failed = true;
+            return;
+        }
+        b->edges = edges;
+        b->edge_capacity = capacity;
+    }
+    b->edges[b->edge_count++] = (BuildEdge){ source, target, cost };
+}
+
+static void builder_add_transition(HpaBuilder* b, const PathHierarchy* h, const Map* map,
+                                   int ax, int ay, int bx, int by) {
+    int a = builder_add_node(b, h, ax, ay);
+    int c = builder_add_node(b, h, bx, by);
+    if (a < 0 || c < 0) return;
+    builder_add_edge(b, a, c, map->cost_field[by * map->width + bx]);
+    builder_add_edge(b, c, a, map->cost_field[ay * map->width + ax]);
+}
+
+/// Scans the border between two clusters and adds the transitions of every
+/// walkable opening along it. (ax, ay) walks the near side, the far side is one
+/// tile away in the (dx, dy) direction and the scan advances along (sx, sy)
+static void builder_scan_border(HpaBuilder* b, const PathHierarchy* h, const Map* map,
+                                int ax, int ay, int dx, int dy, int sx, int sy, int length) {
+    int run_start = -1;
+    for (int i = 0; i <= length; i++) {
+        bool open = false;
+        if (i < length) {
+            int x = ax + sx * i;
+            int y = ay + sy * i;
+            open = map->cost_field[y * map->width + x] != 0 && map->cost_field[(y + dy) * map->width + x + dx] != 0;
+        }
+
+        if (open && run_start < 0) {
+            run_start = i;
+        } else if (!open && run_start >= 0) {
+            int run_end = i - 1;
+            if (run_end - run_start + 1 < HPA_MAX_ENTRANCE_WIDTH) {
+                int mid = (run_start + run_end) / 2;
+                builder_add_transition(b, h, map, ax + sx * mid, ay + sy * mid, ax + sx * mid + dx, ay + sy * mid + dy);
+            } else {
+                builder_add_transition(b, h, map, ax + sx * run_start, ay + sy * run_start, ax + sx * run_start + dx, ay + sy * run_start + dy);
+                builder_add_transition(b, h, map, ax + sx * run_end, ay + sy * run_end, ax + sx * run_end + dx, ay + sy * run_end + dy);
+            }
+            run_start = -1;
+        }
+    }
+}
+
+PathHierarchy* hpa_build(const Map* map, int cluster_size) {
+    if (!map->cost_field || cluster_size <= 0) return NULL;
+
+    PathHierarchy* h = (PathHierarchy*)calloc(1, sizeof(PathHierarchy));
+    if (!h) return NULL;
+    h->width = map->width;
+    h->height = map->height;
+    h->cluster_size = cluster_size;
+    h->clusters_x = (map->width + cluster_size - 1) / cluster_size;
+    h->clusters_y = (map->height + cluster_size - 1) / cluster_size;
+    const int cluster_count = h->clusters_x * h->clusters_y;
+
+    HpaBuilder b = { 0 };
+    b.tile_node = (int*)malloc((size_t)map->width * map->height * sizeof(int));
+    ClusterSearch cs;
+    if (!b.tile_node || !cluster_search_init(&cs, cluster_size)) {
+        printf("Error: Could not allocate the path hierarchy\n");
+        free(b.tile_node);
+        free(h);
+        return NULL;
+    }
+    memset(b.tile_node, 0xff, (size_t)map->width * map->height * sizeof(int));
+
+    // Entrances between horizontal and vertical neighbours
+    for (int cy = 0; cy < h->clusters_y; cy++) {
+        for (int cx = 0; cx < h->clusters_x; cx++) {
+            int x0 = cx * cluster_size;
+            int y0 = cy * cluster_size;
+            int w = map->width - x0 < cluster_size ? map->width - x0 : cluster_size;
+            int ht = map->height - y0 < cluster_size ? map->height - y0 : cluster_size;
+            if (cx + 1 < h->clusters_x) {
+                builder_scan_border(&b, h, map, x0 + w - 1, y0, 1, 0, 0, 1, ht);
+            }
+            if (cy + 1 < h->clusters_y) {
+                builder_scan_border(&b, h, map, x0, y0 + ht - 1, 0, 1, 1, 0, w);
+            }
+        }
+    }
+
+    // Sort the nodes by cluster so every cluster owns a contiguous range
+    h->cluster_first_node = (int*)calloc(cluster_count + 1, sizeof(int));
+    h->nodes = (HpaNode*)malloc((b.node_count > 0 ? b.node_count : 1) * sizeof(HpaNode));
+    int* remap = (int*)malloc((b.node_count > 0 ? b.node_count : 1) * sizeof(int));
+    int* fill = (int*)malloc((cluster_count + 1) * sizeof(int));
+    bool ok = !b.failed && h->cluster_first_node && h->nodes && remap && fill;
+    if (ok) {
+        for (int i = 0; i < b.node_count; i++) h->cluster_first_node[b.nodes[i].cluster + 1]++;
+        for (int c = 0; c < cluster_count; c++) {
+            h->cluster_first_node[c + 1] += h->cluster_first_node[c];
+            int nodes_in_cluster = h->cluster_first_node[c + 1] - h->cluster_first_node[c];
+            if (nodes_in_cluster > h->max_cluster_nodes) h->max_cluster_nodes = nodes_in_cluster;
+        }
+        memcpy(fill, h->cluster_first_node, (cluster_count + 1) * sizeof(int));
+        for (int i = 0; i < b.node_count; i++) {
+            remap[i] = fill[b.nodes[i].cluster]++;
+            h->nodes[remap[i]] = b.nodes[i];
+        }
+        h->node_count = b.node_count;
+        for (int i = 0; i < b.edge_count; i++) {
+            b.edges[i].source = remap[b.edges[i].source];
+            b.edges[i].target = remap[b.edges[i].target];
+        }
+
+        // Intra-cluster edges, one Dijkstra per entrance restricted to its cluster
+        for (int c = 0; c < cluster_count && !b.failed; c++) {
+            for (int u = h->cluster_first_node[c]; u < h->cluster_first_node[c + 1]; u++) {
+                cluster_search(&cs, h, map, c, h->nodes[u].x, h->nodes[u].y, false, -1);
+                for (int v = h->cluster_first_node[c]; v < h->cluster_first_node[c + 1]; v++) {
+                    if (v == u) continue;
+                    int dist = cs.dist[cluster_local_index(&cs, h->nodes[v].x, h->nodes[v].y)];
+                    if (dist != UNREACHED) builder_add_edge(&b, u, v, dist);
+                }
+            }
+        }
+        h->edges = (HpaEdge*)malloc((b.edge_count > 0 ? b.edge_count : 1) * sizeof(HpaEdge));
+        ok = !b.failed && h->edges;
+    }
+
+    if (ok) {
+        // Pack the edges by source node
+        for (int i = 0; i < b.edge_count; i++) h->nodes[b.edges[i].source].edge_count++;
+        int offset = 0;
+        for (int i = 0; i < h->node_count; i++) {
+            h->nodes[i].first_edge = offset;
+            offset += h->nodes[i].edge_count;
+            h->nodes[i].edge_count = 0;
+        }
+        for (int i = 0; i < b.edge_count; i++) {
+            HpaNode* source = &h->nodes[b.edges[i].source];
+            h->edges[source->first_edge + source->edge_count++] = (HpaEdge){ b.edges[i].target, b.edges[i].cost };
+        }
+        h->edge_count = b.edge_count;
+        printf("[HPA] Built %d clusters, %d entrances, %d edges\n", cluster_count, h->node_count, h->edge_count);
+    }
+
+    free(fill);
+    free(remap);
+    free(b.nodes);
+    free(b.edges);
+    free(b.tile_node);
+    cluster_search_free(&cs);
+    // The game searches without the hierarchy when there is none
+    if (!ok) {
+        printf("Error: Could not allocate the path hierarchy\n");
+        hpa_destroy(h);
+        return NULL;
+    }
+    return h;
+}
+
+void hpa_destroy(PathHierarchy* hierarchy) {
+    if (hierarchy) {
+        free(hierarchy->nodes);
+        free(hierarchy->edges);
+        free(hierarchy->cluster_first_node);
+        free(hierarchy);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Query
+// -----------------------------------------------------------------------------
+
+int hpa_workspace_expanded(const HpaWorkspace* workspace) {
+    return workspace->expanded + workspace->local.expanded;
+}
+
+HpaWorkspace* hpa_workspace_create(const PathHierarchy* hierarchy) {
+    HpaWorkspace* ws = (HpaWorkspace*)calloc(1, sizeof(HpaWorkspace));
+    if (!ws) return NULL;
+
+    int total = hierarchy->node_count + 2;
+    int per_cluster = hierarchy->max_cluster_nodes > 0 ? hierarchy->max_cluster_nodes : 1;
+    bool ok = cluster_search_init(&ws->local, hierarchy->cluster_size);
+    ws->nodes = (AbstractNode*)calloc(total, sizeof(AbstractNode));
+    ws->heap = (int*)malloc(total * sizeof(int));
+    ws->route = (int*)malloc(total * sizeof(int));
+    ws->start_node = (int*)malloc(per_cluster * sizeof(int));
+    ws->start_cost = (int*)malloc(per_cluster * sizeof(int));
+    ws->goal_cost = (int*)malloc(per_cluster * sizeof(int));
+
+    if (!ok || !ws->nodes || !ws->heap || !ws->route || !ws->start_node || !ws->start_cost || !ws->goal_cost) {
+        hpa_workspace_destroy(ws);
+        return NULL;
+    }
+    return ws;
+}
+
+void hpa_workspace_destroy(HpaWorkspace* workspace) {
+    if (workspace) {
+        cluster_search_free(&workspace->local);
+        free(workspace->nodes);
+        free(workspace->heap);
+        free(workspace->route);
+        free(workspace->start_node);
+        free(workspace->start_cost);
+        free(workspace->goal_cost);
+        free(workspace);
+    }
+}
+
+static void abstract_swap(HpaWorkspace* ws, int a, int b) {
+    int temp = ws->heap[a];
+    ws->heap[a] = ws->heap[b];
+    ws->heap[b] = temp;
+    ws->nodes[ws->heap[a]].heap_index = a;
+    ws->nodes[ws->heap[b]].heap_index = b;
+}
+
+static void abstract_heapify_up(HpaWorkspace* ws, int index) {
+    while (index > 0) {
+        int parent_index = (index - 1) / 2;
+        if (ws->nodes[ws->heap[index]].f_score >= ws->nodes[ws->heap[parent_index]].f_score) break;
+        abstract_swap(ws, index, parent_index);
+        index = parent_index;
+    }
+}
+
+static void abstract_heapify_down(HpaWorkspace* ws, int index) {
+    while (1) {
+        int left = 2 * index + 1;
+        int right = 2 * index + 2;
+        int smallest = index;
+        if (left < ws->heap_count && ws->nodes[ws->heap[left]].f_score < ws->nodes[ws->heap[smallest]].f_score) smallest = left;
+        if (right < ws->heap_count && ws->nodes[ws->heap[right]].f_score < ws->nodes[ws->heap[smallest]].f_score) smallest = right;
+        if (smallest == index) break;
+        abstract_swap(ws, index, smallest);
+        index = smallest;
+    }
+}
+
+static int abstract_pop(HpaWorkspace* ws) {
+    ws->expanded++;
+    int top = ws->heap[0];
+    ws->heap_count--;
+    if (ws->heap_count > 0) {
+        ws->heap[0] = ws->heap[ws->heap_count];
+        ws->nodes[ws->heap[0]].heap_index = 0;
+        abstract_heapify_down(ws, 0);
+    }
+    ws->nodes[top].heap_index = -1;
+    return top;
+}
+
+static void abstract_relax(HpaWorkspace* ws, int node, int parent, int g_score, int h_score) {
+    AbstractNode* n = &ws->nodes[node];
+    if (n->generation != ws->generation) {
+        n->generation = ws->generation;
+        n->heap_index = -1;
+    } else if (g_score >= n->g_score) {
+        return;
+    }
+    n->g_score = g_score;
+    n->f_score = g_score + h_score;
+    n->parent = parent;
+    if (n->heap_index < 0) {
+        ws->heap[ws->heap_count] = node;
+        n->heap_index = ws->heap_count;
+        ws->heap_count++;
+    }
+    abstract_heapify_up(ws, n->heap_index);
+}
+
+/// Appends a tile to the path, merging it into the last waypoint when it
+/// continues a straight run. Returns false once the path is full
+static bool path_append(Path* out, int x, int y) {
+    Vector2f p = { x * TILE_SIZE, y * TILE_SIZE };
+    if (out->count >= 2) {
+        Vector2f a = out->points[out->count - 2];
+        Vector2f b = out->points[out->count - 1];
+        bool same_column = a.x == b.x && b.x == p.x && (b.y - a.y) * (p.y - b.y) > 0;
+        bool same_row = a.y == b.y && b.y == p.y && (b.x - a.x) * (p.x - b.x) > 0;
+        if (same_column || same_row) {
+            out->points[out->count - 1] = p;
+            return true;
+        }
+    }
+    if (out->count >= MAX_PATH_LENGTH) return false;
+    out->points[out->count++] = p;
+    return true;
+}
+
+/// Refines one abstract edge that stays inside a cluster into tiles
+static bool refine_in_cluster(HpaWorkspace* ws, const PathHierarchy* h, const Map* map,
+                              int from_x, int from_y, int to_x, int to_y, Path* out) {
+    if (from_x == to_x && from_y == to_y) return true;
+
+    ClusterSearch* cs = &ws->local;
+    int cluster = cluster_of(h, from_x, from_y);
+    cluster_set_bounds(cs, h, cluster);
+    int stop = cluster_local_index(cs, to_x, to_y);
+
+    cluster_search(cs, h, map, cluster, from_x, from_y, false, stop);
+    if (cs->dist[stop] == UNREACHED) return false;
+
+    int length = 0;
+    for (int i = stop; cs->parent[i] != -1; i = cs->parent[i]) {
+        cs->trace[length++] = i;
+    }
+    for (int i = length - 1; i >= 0; i--) {
+        if (!path_append(out, cs->x0 + cs->trace[i] % cs->w, cs->y0 + cs->trace[i] / cs->w)) return false;
+    }
+    return true;
+}
+
+bool hpa_find_path(const PathHierarchy* h, HpaWorkspace* ws, const Map* map,
+                   int start_x, int start_y, int end_x, int end_y, Path* out) {
+    const int start = h->node_count;
+    const int goal = h->node_count + 1;
+    const int start_cluster = cluster_of(h, start_x, start_y);
+    const int goal_cluster = cluster_of(h, end_x, end_y);
+    const int goal_first = h->cluster_first_node[goal_cluster];
+    const int goal_last = h->cluster_first_node[goal_cluster + 1];
+
+    if (++ws->generation == 0) {
+        for (int i = 0; i < h->node_count + 2; i++) ws->nodes[i].generation = 0;
+        ws->generation = 1;
+    }
+    ws->heap_count = 0;
+    ws->expanded = 0;
+    ws->local.expanded = 0;
+
+    // Connect the start tile to the entrances of its cluster
+    int direct_cost = UNREACHED;
+    ClusterSearch* cs = &ws->local;
+    cluster_search(cs, h, map, start_cluster, start_x, start_y, false, -1);
+    ws->start_edge_count = 0;
+    for (int v = h->cluster_first_node[start_cluster]; v < h->cluster_first_node[start_cluster + 1]; v++) {
+        int dist = cs->dist[cluster_local_index(cs, h->nodes[v].x, h->nodes[v].y)];
+        if (dist == UNREACHED) continue;
+        ws->start_node[ws->start_edge_count] = v;
+        ws->start_cost[ws->start_edge_count] = dist;
+        ws->start_edge_count++;
+    }
+    if (start_cluster == goal_cluster) {
+        direct_cost = cs->dist[cluster_local_index(cs, end_x, end_y)];
+    }
+
+    // And the entrances of the goal cluster to the goal tile
+    cluster_search(cs, h, map, goal_cluster, end_x, end_y, true, -1);
+    for (int v = goal_first; v < goal_last; v++) {
+        ws->goal_cost[v - goal_first] = cs->dist[cluster_local_index(cs, h->nodes[v].x, h->nodes[v].y)];
+    }
+
+    // A* over the abstract graph
+    abstract_relax(ws, start, -1, 0, abs(start_x - end_x) + abs(start_y - end_y));
+    bool found = false;
+    while (ws->heap_count > 0) {
+        int current = abstract_pop(ws);
+        if (current == goal) {
+            found = true;
+            break;
+        }
+
+        int current_g = ws->nodes[current].g_score;
+        if (current == start) {
+            for (int i = 0; i < ws->start_edge_count; i++) {
+                const HpaNode* n = &h->nodes[ws->start_node[i]];
+                abstract_relax(ws, ws->start_node[i], start, current_g + ws->start_cost[i],
+                               abs(n->x - end_x) + abs(n->y - end_y));
+            }
+            if (direct_cost != UNREACHED) {
+                abstract_relax(ws, goal, start, current_g + direct_cost, 0);
+            }
+            continue;
+        }
+
+        const HpaNode* node = &h->nodes[current];
+        for (int e = node->first_edge; e < node->first_edge + node->edge_count; e++) {
+            const HpaNode* n = &h->nodes[h->edges[e].target];
+            abstract_relax(ws, h->edges[e].target, current, current_g + h->edges[e].cost,
+                           abs(n->x - end_x) + abs(n->y - end_y));
+        }
+        if (current >= goal_first && current < goal_last && ws->goal_cost[current - goal_first] != UNREACHED) {
+            abstract_relax(ws, goal, current, current_g + ws->goal_cost[current - goal_first], 0);
+        }
+    }
+    if (!found) return false;
+
+    // Walk the abstract route back and refine it front to back
+    int route_length = 0;
+    for (int i = goal; i != -1; i = ws->nodes[i].parent) {
+        ws->route[route_length++] = i;
+    }
+
+    out->count = 0;
+    out->current_node = 0;
+    path_append(out, start_x, start_y);
+
+    int from_x = start_x;
+    int from_y = start_y;
+    for (int i = route_length - 2; i >= 0; i--) {
+        int to_x = ws->route[i] == goal ? end_x : h->nodes[ws->route[i]].x;
+        int to_y = ws->route[i] == goal ? end_y : h->nodes[ws->route[i]].y;
+
+        bool ok;
+        if (cluster_of(h, from_x, from_y) == cluster_of(h, to_x, to_y)) {
+            ok = refine_in_cluster(ws, h, map, from_x, from_y, to_x, to_y, out);
+        } else {
+            // Transitions always join two adjacent tiles
+            ok = path_append(out, to_x, to_y);
+        }
+        // A full path keeps its first part, the enemy replans when it ends
+        if (!ok) break;
+
+        from_x = to_x;
+        from_y = to_y;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef HPA_H
+#define HPA_H
+
+/// Hierarchical pathfinding (HPA*)
+/// The map is cut into square clusters, the walkable openings between two
+/// clusters become abstract nodes and the costs between the nodes of a cluster
+/// are precomputed at load time. A query searches that small abstract graph
+/// first and only then refines the route tile by tile inside each cluster.
+
+#include <stdbool.h>
+#include "../map/map.h"
+#include "pathfinding.h"
+
+#define HPA_CLUSTER_SIZE 16
+
+// Queries shorter than this (in tiles, manhattan) use the flat search
+#define HPA_MIN_QUERY_DISTANCE (HPA_CLUSTER_SIZE * 2)
+
+/// Abstract graph, read only once built
+typedef struct PathHierarchy PathHierarchy;
+
+/// Per query scratch memory, one per PathfindingContext
+typedef struct HpaWorkspace HpaWorkspace;
+
+// Builds the clusters, entrances and intra-cluster edges from map->cost_field
+PathHierarchy* hpa_build(const Map* map, int cluster_size);
+void hpa_destroy(PathHierarchy* hierarchy);
+
+HpaWorkspace* hpa_workspace_create(const PathHierarchy* hierarchy);
+void hpa_workspace_destroy(HpaWorkspace* workspace);
+// Nodes the last query expanded, abstract nodes plus the tiles of the
+// cluster searches around the start, the goal and the refined edges
+int hpa_workspace_expanded(const HpaWorkspace* workspace);
+
+// Finds a path between two tiles, the result is written into out the same way
+// the flat search does. Straight runs are merged into a single waypoint so long
+// routes fit in MAX_PATH_LENGTH, if they still do not the first part is kept
+bool hpa_find_path(const PathHierarchy* hierarchy, HpaWorkspace* workspace, const Map* map,
+                   int start_x, int start_y, int end_x, int end_y, Path* out);
+
+#endif // HPA_H
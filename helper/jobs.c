@@ -0,0 +1,232 @@
+// stalker-c/helper/jobs.c
+
+#include "jobs.h"
+#include "trace.h"
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef struct {
+    int begin;
+    int end;
+} JobRange;
+
+// One per thread taking part, the caller included. The owner takes chunks from
+// the back, thieves from the front, so they rarely want the same one
+typedef struct {
+    SDL_SpinLock lock;
+    JobRange* ranges;
+    int head;     // Next chunk a thief takes
+    int tail;     // One past the next chunk the owner takes
+    int capacity;
+} JobQueue;
+
+typedef struct {
+    JobSystem* system;
+    int index;    // Queue of this worker, 0 is the caller's
+    SDL_Thread* thread;
+} JobWorker;
+
+struct JobSystem {
+    SDL_Mutex* lock;
+    SDL_Condition* wake;     // A new loop was started, or quit was set
+    SDL_Condition* done;     // The last chunk of the loop finished
+    bool quit;
+    int generation;          // Bumped for every loop so sleeping workers know
+
+    // The loop being run, set before its chunks are queued
+    JobRangeFunc func;
+    void* data;
+    SDL_AtomicInt remaining; // Chunks queued or running
+
+    JobQueue* queues;        // worker_count + 1
+    JobWorker* workers;
+    int worker_count;
+};
+
+static bool queue_pop(JobQueue* queue, JobRange* out) {
+    bool found = false;
+    SDL_LockSpinlock(&queue->lock);
+    if (queue->tail > queue->head) {
+        *out = queue->ranges[--queue->tail];
+        found = true;
+    }
+    SDL_UnlockSpinlock(&queue->lock);
+    return found;
+}
+
+static bool queue_steal(JobQueue* queue, JobRange* out) {
+    bool found = false;
+    SDL_LockSpinlock(&queue->lock);
+    if (queue->tail > queue->head) {
+        *out = queue->ranges[queue->head++];
+        found = true;
+    }
+    SDL_UnlockSpinlock(&queue->lock);
+    return found;
+}
+
+// Runs chunks until there is nothing left to take anywhere
+static void run_chunks(JobSystem* system, int self) {
+    const int queue_count = system->worker_count + 1;
+    JobRange range;
+    while (true) {
+        bool found = queue_pop(&system->queues[self], &range);
+        for (int k = 1; !found && k < queue_count; k++) {
+            found = queue_steal(&system->queues[(self + k) % queue_count], &range);
+        }
+        if (!found) return;
+
+        system->func(system->data, range.begin, range.end);
+        if (SDL_AddAtomicInt(&system->remaining, -1) == 1) {
+            SDL_LockMutex(system->lock);
+            SDL_BroadcastCondition(system->done);
+            SDL_UnlockMutex(system->lock);
+        }
+    }
+}
+
+static int worker_main(void* data) {
+    JobWorker* worker = (JobWorker*)data;
+    JobSystem* system = worker->system;
+    trace_name_thread("jobs");
+
+    SDL_LockMutex(system->lock);
+    int seen = system->generation;
+    while (true) {
+        while (!system->quit && system->generation == seen) {
+            SDL_WaitCondition(system->wake, system->lock);
+        }
+        if (system->quit) break;
+        seen = system->generation;
+        SDL_UnlockMutex(system->lock);
+
+        run_chunks(system, worker->index);
+
+        SDL_LockMutex(system->lock);
+    }
+    SDL_UnlockMutex(system->lock);
+    return 0;
+}
+
+JobSystem* jobs_create(int worker_count) {
+    if (worker_count < 0) worker_count = 0;
+
+    JobSystem* system = (JobSystem*)calloc(1, sizeof(JobSystem));
+    if (!system) return NULL;
+    system->lock = SDL_CreateMutex();
+    system->wake = SDL_CreateCondition();
+    system->done = SDL_CreateCondition();
+    system->queues = (JobQueue*)calloc(worker_count + 1, sizeof(JobQueue));
+    system->workers = (JobWorker*)calloc(worker_count > 0 ? worker_count : 1, sizeof(JobWorker));
+    if (!system->lock || !system->wake || !system->done || !system->queues || !system->workers) {
+        jobs_destroy(system);
+        return NULL;
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        JobWorker* worker = &system->workers[i];
+        worker->system = system;
+        worker->index = i + 1;
+        worker->thread = SDL_CreateThread(worker_main, "jobs", worker);
+        if (!worker->thread) {
+            printf("Error: Could not start job worker %d: %s\n", i + 1, SDL_GetError());
+            break;
+        }
+        system->worker_count++;
+    }
+    printf("[JOBS] Started %d job workers\n", system->worker_count);
+    return system;
+}
+
+void jobs_destroy(JobSystem* system) {
+    if (!system) return;
+
+    if (system->lock) {
+        SDL_LockMutex(system->lock);
+        system->quit = true;
+        SDL_BroadcastCondition(system->wake);
+        SDL_UnlockMutex(system->lock);
+    }
+    for (int i = 0; i < system->worker_count; i++) {
+        SDL_WaitThread(system->workers[i].thread, NULL);
+    }
+
+    if (system->queues) {
+        for (int i = 0; i <= system->worker_count; i++) {
+            free(system->queues[i].ranges);
+        }
+    }
+    free(system->queues);
+    free(system->workers);
+    SDL_DestroyCondition(system->wake);
+    SDL_DestroyCondition(system->done);
+    SDL_DestroyMutex(system->lock);
+    free(system);
+}
+
+int jobs_worker_count(const JobSystem* system) {
+    return system ? system->worker_count : 0;
+}
+
+void jobs_parallel_for(JobSystem* system, int count, int grain, JobRangeFunc func, void* data) {
+    if (count <= 0) return;
+    if (grain < 1) grain = 1;
+    const int chunk_count = (count + grain - 1) / grain;
+    // Not worth waking anybody for a single chunk
+    if (!system || system->worker_count == 0 || chunk_count == 1) {
+        func(data, 0, count);
+        return;
+    }
+
+    // Every queue gets a contiguous run of chunks, neighbouring indices tend
+    // to touch neighbouring memory
+    const int queue_count = system->worker_count + 1;
+    const int per_queue = (chunk_count + queue_count - 1) / queue_count;
+    for (int q = 0; q < queue_count; q++) {
+        JobQueue* queue = &system->queues[q];
+        if (queue->capacity >= per_queue) continue;
+        SDL_LockSpinlock(&queue->lock);
+        JobRange* ranges = (JobRange*)realloc(queue->ranges, per_queue * sizeof(JobRange));
+        if (ranges) {
+            queue->ranges = ranges;
+            queue->capacity = per_queue;
+        }
+        SDL_UnlockSpinlock(&queue->lock);
+        if (!ranges) {
+            func(data, 0, count);
+            return;
+        }
+    }
+
+    system->func = func;
+    system->data = data;
+    SDL_SetAtomicInt(&system->remaining, chunk_count);
+    for (int q = 0; q < queue_count; q++) {
+        JobQueue* queue = &system->queues[q];
+        const int first = q * per_queue;
+        const int last = SDL_min(first + per_queue, chunk_count);
+        // Pushed back to front so the owner, who pops from the back, walks
+        // its run in index order. The queues are all empty between loops
+        SDL_LockSpinlock(&queue->lock);
+        queue->head = 0;
+        queue->tail = 0;
+        for (int c = last - 1; c >= first; c--) {
+            queue->ranges[queue->tail++] = (JobRange){ c * grain, SDL_min((c + 1) * grain, count) };
+        }
+        SDL_UnlockSpinlock(&queue->lock);
+    }
+
+    SDL_LockMutex(system->lock);
+    system->generation++;
+    SDL_BroadcastCondition(system->wake);
+    SDL_UnlockMutex(system->lock);
+
+    run_chunks(system, 0);
+
+    SDL_LockMutex(system->lock);
+    while (SDL_GetAtomicInt(&system->remaining) > 0) {
+        SDL_WaitCondition(system->done, system->lock);
+    }
+    SDL_UnlockMutex(system->lock);
+}
@@ -0,0 +1,31 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/// Work stealing pool for data parallel loops
+/// jobs_parallel_for cuts an index range into chunks and deals them out to
+/// the workers and to the calling thread, each one owning a queue of chunks.
+/// Everyone works through their own queue and, once it is empty, steals from
+/// the others, so a chunk that turns out slow doesn't hold up the rest. The
+/// call returns when every chunk has run.
+///
+/// The chunks run in no particular order and on any thread, the function
+/// must only write what belongs to the indices it was given
+
+#include <stdbool.h>
+
+typedef struct JobSystem JobSystem;
+
+// Runs func on the indices [begin, end)
+typedef void (*JobRangeFunc)(void* data, int begin, int end);
+
+// Starts worker_count threads next to the caller. With 0 workers, or on a
+// NULL system, jobs_parallel_for runs everything on the calling thread
+JobSystem* jobs_create(int worker_count);
+void jobs_destroy(JobSystem* system);
+int jobs_worker_count(const JobSystem* system);
+
+// Calls func over [0, count) in chunks of at most grain indices and waits for
+// all of them. Must not be called from inside a job
+void jobs_parallel_for(JobSystem* system, int count, int grain, JobRangeFunc func, void* data);
+
+#endif // JOBS_H
@@ -1,36 +1,57 @@
 // stalker-c/helper/pathfinding.c
 
 #include "pathfinding.h"
+#include "hpa.h"
+#include "profiler.h"
+#include "trace.h"
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <float.h>
+#include <limits.h>
 #include <stdbool.h>
 
-typedef struct Node {
-    int x, y;
+// Nodes live in a flat array indexed by y * width + x
+// A node is only valid for the current query if its generation matches the
+// context generation, so resetting the arena is a single increment
+typedef struct {
     float g_score;
     float f_score;
-    struct Node* parent;
-    bool in_open_set;
+    int parent;      // Flat index of the previous tile, -1 for the start
+    int heap_index;  // Position inside the open heap, -1 when not in it
+    uint32_t generation;
 } Node;
 
-typedef struct {
-    Node** nodes;
-    int count;
-    int capacity;
-} PriorityQueue;
-
-static void swap_nodes(Node** a, Node** b) {
-    Node* temp = *a;
-    *a = *b;
-    *b = temp;
+struct PathfindingContext {
+    int width;
+    int height;
+    Node* nodes;
+    int* heap;       // Binary min-heap of flat node indices ordered by f_score
+    int heap_count;
+    uint32_t generation;
+    HpaWorkspace* hpa; // Scratch memory for hierarchical queries, NULL without a hierarchy
+    int expanded;      // Nodes taken off the open set by the last query
+
+    // The search in progress
+    PathSearchStatus status;
+    int end_x;
+    int end_y;
+    Path result;       // Valid once status is PATH_SEARCH_FOUND
+};
+
+static void heap_swap(PathfindingContext* ctx, int a, int b) {
+    int temp = ctx->heap[a];
+    ctx->heap[a] = ctx->heap[b];
+    ctx->heap[b] = temp;
+    ctx->nodes[ctx->heap[a]].heap_index = a;
+    ctx->nodes[ctx->heap[b]].heap_index = b;
 }
 
-static void heapify_up(PriorityQueue* pq, int index) {
+static void heapify_up(PathfindingContext* ctx, int index) {
     while (index > 0) {
         int parent_index = (index - 1) / 2;
-        if (pq->nodes[index]->f_score < pq->nodes[parent_index]->f_score) {
-            swap_nodes(&pq->nodes[index], &pq->nodes[parent_index]);
+        if (ctx->nodes[ctx->heap[index]].f_score < ctx->nodes[ctx->heap[parent_index]].f_score) {
+            heap_swap(ctx, index, parent_index);
             index = parent_index;
         } else {
             break;
@@ -38,22 +59,22 @@ static void heapify_up(PriorityQueue* pq, int index) {
     }
 }
 
-static void heapify_down(PriorityQueue* pq, int index) {
+static void heapify_down(PathfindingContext* ctx, int index) {
     int left_child_index, right_child_index, smallest_child_index;
     while (1) {
         left_child_index = 2 * index + 1;
         right_child_index = 2 * index + 2;
         smallest_child_index = index;
 
-        if (left_child_index < pq->count && pq->nodes[left_child_index]->f_score < pq->nodes[smallest_child_index]->f_score) {
+        if (left_child_index < ctx->heap_count && ctx->nodes[ctx->heap[left_child_index]].f_score < ctx->nodes[ctx->heap[smallest_child_index]].f_score) {
             smallest_child_index = left_child_index;
         }
-        if (right_child_index < pq->count && pq->nodes[right_child_index]->f_score < pq->nodes[smallest_child_index]->f_score) {
+        if (right_child_index < ctx->heap_count && ctx->nodes[ctx->heap[right_child_index]].f_score < ctx->nodes[ctx->heap[smallest_child_index]].f_score) {
             smallest_child_index = right_child_index;
         }
 
         if (smallest_child_index != index) {
-            swap_nodes(&pq->nodes[index], &pq->nodes[smallest_child_index]);
+            heap_swap(ctx, index, smallest_child_index);
             index = smallest_child_index;
         } else {
             break;
@@ -61,168 +82,260 @@ static void heapify_down(PriorityQueue* pq, int index) {
     }
 }
 
-static PriorityQueue* pq_create(int width, int height) {
-    PriorityQueue* pq = (PriorityQueue*)malloc(sizeof(PriorityQueue));
-    pq->capacity = width * height;
-    pq->nodes = (Node**)malloc(sizeof(Node*) * pq->capacity);
-    pq->count = 0;
-    return pq;
+static void heap_push(PathfindingContext* ctx, int node_index) {
+    ctx->heap[ctx->heap_count] = node_index;
+    ctx->nodes[node_index].heap_index = ctx->heap_count;
+    ctx->heap_count++;
+    heapify_up(ctx, ctx->heap_count - 1);
+}
+
+static int heap_pop(PathfindingContext* ctx) {
+    ctx->expanded++;
+    int top = ctx->heap[0];
+    ctx->heap_count--;
+    if (ctx->heap_count > 0) {
+        ctx->heap[0] = ctx->heap[ctx->heap_count];
+        ctx->nodes[ctx->heap[0]].heap_index = 0;
+        heapify_down(ctx, 0);
+    }
+    ctx->nodes[top].heap_index = -1;
+    return top;
 }
 
-static void pq_push(PriorityQueue* pq, Node* node) {
-    if (pq->count >= pq->capacity) return;
-    pq->nodes[pq->count] = node;
-    node->in_open_set = true;
-    heapify_up(pq, pq->count);
-    pq->count++;
+static float heuristic(int x1, int y1, int x2, int y2) {
+    return abs(x1 - x2) + abs(y1 - y2);
 }
 
-static Node* pq_pop(PriorityQueue* pq) {
-    if (pq->count == 0) return NULL;
-    Node* top_node = pq->nodes[0];
-    pq->nodes[0] = pq->nodes[pq->count - 1];
-    pq->count--;
-    heapify_down(pq, 0);
-    top_node->in_open_set = false;
-    return top_node;
+PathfindingContext* pathfinding_context_create(const Map* map) {
+    PathfindingContext* ctx = (PathfindingContext*)malloc(sizeof(PathfindingContext));
+    if (!ctx) return NULL;
+
+    ctx->width = map->width;
+    ctx->height = map->height;
+    ctx->nodes = (Node*)calloc((size_t)map->width * map->height, sizeof(Node));
+    ctx->heap = (int*)malloc((size_t)map->width * map->height * sizeof(int));
+    ctx->heap_count = 0;
+    ctx->generation = 0;
+    ctx->expanded = 0;
+    ctx->status = PATH_SEARCH_FAILED;
+    ctx->hpa = map->hierarchy ? hpa_workspace_create(map->hierarchy) : NULL;
+
+    if (!ctx->nodes || !ctx->heap || (map->hierarchy && !ctx->hpa)) {
+        pathfinding_context_destroy(ctx);
+        return NULL;
+    }
+    return ctx;
 }
 
-static void pq_destroy(PriorityQueue* pq) {
-    free(pq->nodes);
-    free(pq);
+size_t pathfinding_context_bytes(const Map* map) {
+    return (size_t)map->width * map->height * (sizeof(Node) + sizeof(int));
 }
 
-static float heuristic(int x1, int y1, int x2, int y2) {
-    return abs(x1 - x2) + abs(y1 - y2);
+void pathfinding_context_destroy(PathfindingContext* ctx) {
+    if (ctx) {
+        free(ctx->nodes);
+        free(ctx->heap);
+        hpa_workspace_destroy(ctx->hpa);
+        free(ctx);
+    }
 }
 
-Path* pathfinding_find_path(const Map* map, Vector2f start_pos, Vector2f end_pos) {
-    const float map_pixel_width = map->width * TILE_SIZE;
-    const float map_pixel_height = map->height * TILE_SIZE;
+/// Walks the parent chain back from the goal and writes it start first
+/// Paths longer than MAX_PATH_LENGTH keep the first points, the enemy will
+/// replan once it reaches the end of them
+static void build_path(const PathfindingContext* ctx, int goal_index, Path* out) {
+    int length = 0;
+    for (int i = goal_index; i != -1; i = ctx->nodes[i].parent) {
+        length++;
+    }
 
+    int index = goal_index;
+    for (int skip = length - MAX_PATH_LENGTH; skip > 0; skip--) {
+        index = ctx->nodes[index].parent;
+    }
+
+    out->count = length < MAX_PATH_LENGTH ? length : MAX_PATH_LENGTH;
+    for (int i = out->count - 1; i >= 0; i--) {
+        out->points[i] = (Vector2f){
+            (index % ctx->width) * TILE_SIZE,
+            (index / ctx->width) * TILE_SIZE
+        };
+        index = ctx->nodes[index].parent;
+    }
+    out->current_node = 0;
+}
+
+static void search_begin(PathfindingContext* ctx, const Map* map, Vector2f start_pos, Vector2f end_pos) {
     int start_x = (start_pos.x) / TILE_SIZE;
     int start_y = (start_pos.y) / TILE_SIZE;
     int end_x = (end_pos.x) / TILE_SIZE;
     int end_y = (end_pos.y ) / TILE_SIZE;
 
-    if (end_y < 0 || end_y >= map->height || end_x < 0 || end_x >= map->width || map->tiles[end_y][end_x] == 1) {
-        return NULL;
+    ctx->expanded = 0;
+    ctx->heap_count = 0;
+    ctx->status = PATH_SEARCH_FAILED;
+    if (!map->cost_field) {
+        return;
+    }
+    if (end_y < 0 || end_y >= map->height || end_x < 0 || end_x >= map->width || map->cost_field[end_y * map->width + end_x] == 0) {
+        return;
     }
     if (start_y < 0 || start_y >= map->height || start_x < 0 || start_x >= map->width) {
-        return NULL;
+        return;
     }
 
-    Node*** all_nodes = (Node***)malloc(map->height * sizeof(Node**));
-    for (int i = 0; i < map->height; i++) {
-        all_nodes[i] = (Node**)malloc(map->width * sizeof(Node*));
-        memset(all_nodes[i], 0, map->width * sizeof(Node*));
+    // Long queries go through the abstract graph when the level has one
+    if (map->hierarchy && ctx->hpa && abs(start_x - end_x) + abs(start_y - end_y) >= HPA_MIN_QUERY_DISTANCE) {
+        bool found = hpa_find_path(map->hierarchy, ctx->hpa, map, start_x, start_y, end_x, end_y, &ctx->result);
+        ctx->expanded = hpa_workspace_expanded(ctx->hpa);
+        ctx->status = found ? PATH_SEARCH_FOUND : PATH_SEARCH_FAILED;
+        return;
     }
-    
-    PriorityQueue* open_set = pq_create(map->width, map->height); // <-- Pass dimensions here
 
-    Node* start_node = (Node*)malloc(sizeof(Node));
-    start_node->x = start_x;
-    start_node->y = start_y;
+    // Bumping the generation invalidates every node of the previous query
+    // On the (very rare) wrap around the stale generations must be cleared
+    if (++ctx->generation == 0) {
+        for (int i = 0; i < ctx->width * ctx->height; i++) {
+            ctx->nodes[i].generation = 0;
+        }
+        ctx->generation = 1;
+    }
+
+    int start_index = start_y * ctx->width + start_x;
+    Node* start_node = &ctx->nodes[start_index];
     start_node->g_score = 0;
     start_node->f_score = heuristic(start_x, start_y, end_x, end_y);
-    start_node->parent = NULL;
-    start_node->in_open_set = false;
-
-    all_nodes[start_y][start_x] = start_node;
-    pq_push(open_set, start_node);
-
-    while (open_set->count > 0) {
-        Node* current = pq_pop(open_set);
-
-        if (current->x == end_x && current->y == end_y) {
-            // --- Path reconstruction (unchanged) ---
-            Path* path = (Path*)malloc(sizeof(Path));
-            path->count = 0;
-            Node* temp = current;
-            while (temp != NULL) {
-                path->points[path->count++] = (Vector2f){
-                    (temp->x * TILE_SIZE),
-                    (temp->y * TILE_SIZE)
-                };
-                temp = temp->parent;
+    start_node->parent = -1;
+    start_node->generation = ctx->generation;
+    heap_push(ctx, start_index);
+
+    ctx->end_x = end_x;
+    ctx->end_y = end_y;
+    ctx->status = PATH_SEARCH_RUNNING;
+}
+
+static PathSearchStatus search_step(PathfindingContext* ctx, const Map* map, int max_expansions, Path* out) {
+    // Hierarchical and rejected queries are already settled in search_begin
+    if (ctx->status != PATH_SEARCH_RUNNING) {
+        if (out && ctx->status == PATH_SEARCH_FOUND) *out = ctx->result;
+        return ctx->status;
+    }
+
+    const int width = ctx->width;
+    const int end_x = ctx->end_x;
+    const int end_y = ctx->end_y;
+    const int end_index = end_y * width + end_x;
+
+    static const int neighbor_dx[4] = { -1, 0, 0, 1 };
+    static const int neighbor_dy[4] = { 0, -1, 1, 0 };
+
+    for (int budget = max_expansions; ctx->status == PATH_SEARCH_RUNNING && budget > 0; budget--) {
+        if (ctx->heap_count == 0) {
+            ctx->status = PATH_SEARCH_FAILED;
+            break;
+        }
+        int current_index = heap_pop(ctx);
+
+        if (current_index == end_index) {
+            build_path(ctx, current_index, &ctx->result);
+            ctx->status = PATH_SEARCH_FOUND;
+            break;
+        }
+
+        int current_x = current_index % width;
+        int current_y = current_index / width;
+        float current_g = ctx->nodes[current_index].g_score;
+
+        for (int n = 0; n < 4; n++) {
+            int neighbor_x = current_x + neighbor_dx[n];
+            int neighbor_y = current_y + neighbor_dy[n];
+
+            if (neighbor_x < 0 || neighbor_x >= map->width || neighbor_y < 0 || neighbor_y >= map->height) {
+                continue;
             }
-            for(int i = 0; i < path->count / 2; i++){
-                Vector2f temp_point = path->points[i];
-                path->points[i] = path->points[path->count - i - 1];
-                path->points[path->count - i - 1] = temp_point;
+
+            // The wall hugging penalty is baked into the cost field, 0 is a wall
+            int neighbor_index = neighbor_y * width + neighbor_x;
+            uint8_t cost = map->cost_field[neighbor_index];
+            if (cost == 0) {
+                continue;
             }
-            path->current_node = 0;
-
-            pq_destroy(open_set);
-            for (int y = 0; y < map->height; y++) {
-                for (int x = 0; x < map->width; x++) {
-                    if(all_nodes[y][x]) free(all_nodes[y][x]);
-                }
-                free(all_nodes[y]);
+
+            float tentative_g_score = current_g + cost;
+            Node* neighbor = &ctx->nodes[neighbor_index];
+
+            if (neighbor->generation != ctx->generation) {
+                neighbor->generation = ctx->generation;
+                neighbor->heap_index = -1;
+            } else if (tentative_g_score >= neighbor->g_score) {
+                continue;
             }
-            free(all_nodes);
-            return path;
-        }
 
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dy = -1; dy <= 1; dy++) {
-                if (abs(dx) == abs(dy)) continue;
-
-                int neighbor_x = current->x + dx;
-                int neighbor_y = current->y + dy;
-
-                if (neighbor_x < 0 || neighbor_x >= map->width || neighbor_y < 0 || neighbor_y >= map->height || map->tiles[neighbor_y][neighbor_x] == 1) {
-                    continue;
-                }
-
-                float cost = 1.0f;
-                for (int nx = -1; nx <= 1; nx++) {
-                    for (int ny = -1; ny <= 1; ny++) {
-                        if (nx == 0 && ny == 0) continue;
-
-                        int check_x = neighbor_x + nx;
-                        int check_y = neighbor_y + ny;
-
-                        if (check_x >= 0 && check_x < map->width && check_y >= 0 && check_y < map->height) {
-                            if (map->tiles[check_y][check_x] == 1) {
-                                cost += 15.0f;
-                            }
-                        }
-                    }
-                }
-
-                float tentative_g_score = current->g_score + cost;
-                Node* neighbor = all_nodes[neighbor_y][neighbor_x];
-
-                if (!neighbor || tentative_g_score < neighbor->g_score) {
-                    if (!neighbor) {
-                        neighbor = (Node*)malloc(sizeof(Node));
-                        all_nodes[neighbor_y][neighbor_x] = neighbor;
-                        neighbor->in_open_set = false;
-                    }
-                    neighbor->x = neighbor_x;
-                    neighbor->y = neighbor_y;
-                    neighbor->parent = current;
-                    neighbor->g_score = tentative_g_score;
-                    neighbor->f_score = neighbor->g_score + heuristic(neighbor_x, neighbor_y, end_x, end_y);
-
-                    if (!neighbor->in_open_set) {
-                        pq_push(open_set, neighbor);
-                    }
-                }
+            neighbor->parent = current_index;
+            neighbor->g_score = tentative_g_score;
+            neighbor->f_score = tentative_g_score + heuristic(neighbor_x, neighbor_y, end_x, end_y);
+
+            if (neighbor->heap_index < 0) {
+                heap_push(ctx, neighbor_index);
+            } else {
+                heapify_up(ctx, neighbor->heap_index);
             }
         }
     }
 
-    pq_destroy(open_set);
-    for (int y = 0; y < map->height; y++) {
-        for (int x = 0; x < map->width; x++) {
-            if(all_nodes[y][x]) free(all_nodes[y][x]);
-        }
-        free(all_nodes[y]);
+    if (ctx->status == PATH_SEARCH_FOUND && out) {
+        *out = ctx->result;
     }
-    free(all_nodes);
-    return NULL;
+    return ctx->status;
+}
+
+bool pathfinding_find_path_into(PathfindingContext* ctx, const Map* map, Vector2f start_pos, Vector2f end_pos, Path* out) {
+    PROFILE_BEGIN(PROFILE_ZONE_PATHFINDING);
+    TRACE_BEGIN("path query");
+    search_begin(ctx, map, start_pos, end_pos);
+    bool found = search_step(ctx, map, INT_MAX, out) == PATH_SEARCH_FOUND;
+    TRACE_END_ARGS("path query", "expanded", ctx->expanded, "found", found);
+    PROFILE_END(PROFILE_ZONE_PATHFINDING);
+    return found;
+}
+
+void pathfinding_search_begin(PathfindingContext* ctx, const Map* map, Vector2f start_pos, Vector2f end_pos) {
+    PROFILE_BEGIN(PROFILE_ZONE_PATHFINDING);
+    search_begin(ctx, map, start_pos, end_pos);
+    PROFILE_END(PROFILE_ZONE_PATHFINDING);
+}
+
+PathSearchStatus pathfinding_search_step(PathfindingContext* ctx, const Map* map, int max_expansions, Path* out) {
+    PROFILE_BEGIN(PROFILE_ZONE_PATHFINDING);
+    PathSearchStatus status = search_step(ctx, map, max_expansions, out);
+    PROFILE_END(PROFILE_ZONE_PATHFINDING);
+    return status;
+}
+
+int pathfinding_last_expanded(const PathfindingContext* ctx) {
+    return ctx->expanded;
+}
+
+Path* pathfinding_find_path(const Map* map, Vector2f start_pos, Vector2f end_pos) {
+    PathfindingContext* ctx = map->pathfinding;
+    PathfindingContext* temporary = NULL;
+
+    // Maps without an arena still work, they just pay for a temporary one
+    if (!ctx) {
+        temporary = pathfinding_context_create(map);
+        if (!temporary) return NULL;
+        ctx = temporary;
+    }
+
+    Path result;
+    Path* path = NULL;
+    if (pathfinding_find_path_into(ctx, map, start_pos, end_pos, &result)) {
+        path = (Path*)malloc(sizeof(Path));
+        if (path) *path = result;
+    }
+
+    pathfinding_context_destroy(temporary);
+    return path;
 }
 
 void path_destroy(Path* path) {
@@ -1,18 +1,66 @@
 #ifndef PATHFINDING_H
 #define PATHFINDING_H
 
+#include <stdbool.h>
 #include "../helper/vector.h"
 #include "../map/map.h"
 
 #define MAX_PATH_LENGTH 100
 
+// Expansions per pathfinding_search_step call when a search is run in slices
+#define PATH_SEARCH_SLICE 256
+
 typedef struct {
     Vector2f points[MAX_PATH_LENGTH];
     int count;
     int current_node;
 } Path;
 
+/// Reusable search arena, one per thread that searches
+/// It holds a flat node array sized to the map and a preallocated open heap,
+/// so a query never touches the allocator
+typedef struct PathfindingContext PathfindingContext;
+
+// Allocates the arena for the given map, call it once after the map is loaded
+PathfindingContext* pathfinding_context_create(const Map* map);
+
+// Frees the arena
+void pathfinding_context_destroy(PathfindingContext* ctx);
+
+// Bytes the node array and the heap of an arena take for the map, the
+// hierarchical scratch (a few entries per entrance) not counted
+size_t pathfinding_context_bytes(const Map* map);
+
+// Runs a query inside the arena and writes the result into a caller owned path
+// Returns false if no path exists, this function does zero heap allocations
+bool pathfinding_find_path_into(PathfindingContext* ctx, const Map* map, Vector2f start_pos, Vector2f end_pos, Path* out);
+
+// Nodes the last query on this arena expanded, abstract and local ones for a
+// hierarchical query. For a search still running, the ones so far
+int pathfinding_last_expanded(const PathfindingContext* ctx);
+
+/// Resumable queries
+/// The same search as pathfinding_find_path_into, cut into steps of a bounded
+/// number of expansions. The open heap and the node scores stay in the arena
+/// between steps, so a search too big for one frame carries on in the next.
+/// The arena holds one search at a time, starting another or running a
+/// pathfinding_find_path_into on it drops the one in progress
+typedef enum {
+    PATH_SEARCH_RUNNING, // Out of budget, step again
+    PATH_SEARCH_FOUND,
+    PATH_SEARCH_FAILED,
+} PathSearchStatus;
+
+// Starts a search in the arena. Only the flat search is split into steps,
+// hierarchical queries run to the end right here
+void pathfinding_search_begin(PathfindingContext* ctx, const Map* map, Vector2f start_pos, Vector2f end_pos);
+
+// Expands at most max_expansions more nodes. On PATH_SEARCH_FOUND the path is
+// written to out, a finished search keeps returning its result
+PathSearchStatus pathfinding_search_step(PathfindingContext* ctx, const Map* map, int max_expansions, Path* out);
+
 // Main function to find a path from a start to an end point
+// Uses map->pathfinding as the arena, only the returned path is allocated
 Path* pathfinding_find_path(const Map* map, Vector2f start_pos, Vector2f end_pos);
 
 // Function to free the memory used by a path
@@ -0,0 +1,462 @@
+// stalker-c/helper/pathjobs.c
+
+#include "pathjobs.h"
+#include "trace.h"
+#include <SDL3/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE,
+    SLOT_FAILED,
+    SLOT_CANCELLED,
+} SlotState;
+
+// Requests live in a growable slot table, a handle is the slot index plus the
+// slot generation so a stale handle can never read someone else's result
+typedef struct {
+    SlotState state;
+    uint32_t generation;
+    Vector2f start;
+    Vector2f end;
+    Path path;
+    int next;          // Next slot in the queue or in the free list
+    int tick;          // Tick it was submitted on
+    int cancel_tick;   // Tick it was cancelled on
+    uint32_t key;      // See pathjobs_submit
+    uint32_t sequence; // Submission count, orders the searches of one key
+} PathJobSlot;
+
+// A queued search as pathjobs_begin_tick sorts them
+typedef struct {
+    int tick;
+    uint32_t key;
+    uint32_t sequence;
+    int slot;
+} PathJobOrder;
+
+typedef struct {
+    PathJobSystem* system;
+    PathfindingContext* ctx;
+    SDL_Thread* thread;
+} PathWorker;
+
+struct PathJobSystem {
+    Map map;  // Shallow copy, the workers only read the navigation data
+    SDL_Mutex* lock;
+    SDL_Condition* wake;     // New work, a new tick's budget, or quit
+    SDL_Condition* finished; // A search completed or a worker went idle
+    bool quit;
+    bool blocking;           // See pathjobs_set_blocking
+    int tick;                // pathjobs_begin_tick calls so far
+    int budget;              // Expansions left this tick, below 0 is owed to the next
+    int tick_start_budget;   // budget right after the refill
+    int tick_expanded;       // Expansions charged over the last whole tick
+    int running;             // Searches started and not finished, parked ones too
+    int busy;                // Workers searching right now, outside the lock
+    uint32_t sequence;
+
+    PathJobSlot* slots;
+    PathJobOrder* order;     // Scratch for sorting the queue, slot_count long
+    int slot_count;
+    int free_head;
+    int queue_head;
+    int queue_tail;
+
+    PathWorker* workers;
+    int worker_count;
+};
+
+static PathJobHandle make_handle(int slot, uint32_t generation) {
+    return ((uint64_t)generation << 32) | (uint64_t)(slot + 1);
+}
+
+// Returns the slot of a live handle or -1, must be called with the lock held
+static int slot_from_handle(PathJobSystem* system, PathJobHandle handle) {
+    int slot = (int)(handle & 0xffffffffu) - 1;
+    if (handle == PATH_JOB_NONE || slot < 0 || slot >= system->slot_count) return -1;
+    if (system->slots[slot].generation != (uint32_t)(handle >> 32)) return -1;
+    if (system->slots[slot].state == SLOT_FREE) return -1;
+    return slot;
+}
+
+static void release_slot(PathJobSystem* system, int slot) {
+    system->slots[slot].state = SLOT_FREE;
+    system->slots[slot].generation++;
+    system->slots[slot].next = system->free_head;
+    system->free_head = slot;
+}
+
+// The helpers below must be called with the lock held
+
+// A blocking run only sees a cancel from the next tick on, until then the
+// search goes on spending the budget exactly as if nobody had cancelled it
+static bool is_cancelled(PathJobSystem* system, int slot) {
+    const PathJobSlot* job = &system->slots[slot];
+    return job->state == SLOT_CANCELLED && (!system->blocking || job->cancel_tick < system->tick);
+}
+
+// Whether a worker may take the search at the head of the queue. A blocking
+// run steps one search at a time in queue order, and leaves the ones
+// submitted this tick for the next, when they have been sorted
+static bool can_start(PathJobSystem* system) {
+    if (system->queue_head == -1 || system->budget <= 0) return false;
+    if (!system->blocking) return true;
+    return system->running == 0 && system->slots[system->queue_head].tick < system->tick;
+}
+
+// Nothing more happens this tick: the budget is spent, or there is no search
+// left it could go to, and no worker is in the middle of a step
+static bool is_settled(PathJobSystem* system) {
+    if (system->busy > 0) return false;
+    return system->budget <= 0 || (system->running == 0 && !can_start(system));
+}
+
+// Waits for the next tick while this one's budget is spent, returns false on quit
+static bool wait_for_budget(PathJobSystem* system) {
+    while (!system->quit && system->budget <= 0) {
+        SDL_BroadcastCondition(system->finished);
+        SDL_WaitCondition(system->wake, system->lock);
+    }
+    return !system->quit;
+}
+
+// Takes up to a slice from the budget
+static int take_slice(PathJobSystem* system) {
+    int slice = SDL_min(system->budget, PATH_SEARCH_SLICE);
+    system->budget -= slice;
+    return slice;
+}
+
+static int compare_order(const void* a, const void* b) {
+    const PathJobOrder* left = (const PathJobOrder*)a;
+    const PathJobOrder* right = (const PathJobOrder*)b;
+    if (left->tick != right->tick) return left->tick < right->tick ? -1 : 1;
+    if (left->key != right->key) return left->key < right->key ? -1 : 1;
+    if (left->sequence != right->sequence) return left->sequence < right->sequence ? -1 : 1;
+    return 0;
+}
+
+// Puts the queue in (tick, key, submission) order. The searches of one tick
+// come in from whatever thread got there first, their keys don't
+static void sort_queue(PathJobSystem* system) {
+    int count = 0;
+    for (int slot = system->queue_head; slot != -1; slot = system->slots[slot].next) {
+        const PathJobSlot* job = &system->slots[slot];
+        system->order[count++] = (PathJobOrder){ job->tick, job->key, job->sequence, slot };
+    }
+    if (count < 2) return;
+    qsort(system->order, count, sizeof(PathJobOrder), compare_order);
+    for (int i = 0; i < count - 1; i++) {
+        system->slots[system->order[i].slot].next = system->order[i + 1].slot;
+    }
+    system->slots[system->order[count - 1].slot].next = -1;
+    system->queue_head = system->order[0].slot;
+    system->queue_tail = system->order[count - 1].slot;
+}
+
+static int worker_main(void* data) {
+    PathWorker* worker = (PathWorker*)data;
+    PathJobSystem* system = worker->system;
+    Path result;
+    trace_name_thread("pathfinding");
+
+    SDL_LockMutex(system->lock);
+    while (true) {
+        // A new search only starts while the tick has budget left
+        while (!system->quit && !can_start(system)) {
+            SDL_BroadcastCondition(system->finished);
+            SDL_WaitCondition(system->wake, system->lock);
+        }
+        if (system->quit) break;
+
+        int slot = system->queue_head;
+        system->queue_head = system->slots[slot].next;
+        if (system->queue_head == -1) system->queue_tail = -1;
+
+        // Cancelled while it was still waiting in the queue
+        if (is_cancelled(system, slot)) {
+            release_slot(system, slot);
+            continue;
+        }
+
+        if (system->slots[slot].state == SLOT_QUEUED) system->slots[slot].state = SLOT_RUNNING;
+        Vector2f start = system->slots[slot].start;
+        Vector2f end = system->slots[slot].end;
+        system->running++;
+        system->busy++;
+        SDL_UnlockMutex(system->lock);
+
+        TRACE_BEGIN("path query");
+        pathfinding_search_begin(worker->ctx, &system->map, start, end);
+        // A step of nothing tells a hierarchical query, done already, from a
+        // flat one that still has to be stepped
+        PathSearchStatus status = pathfinding_search_step(worker->ctx, &system->map, 0, &result);
+        SDL_LockMutex(system->lock);
+        system->busy--;
+        // What begin expanded counts too, all of a hierarchical query, and
+        // whatever it overdraws comes off the next tick
+        system->budget -= pathfinding_last_expanded(worker->ctx);
+        // The slot table may have grown meanwhile, only index it under the lock
+        while (status == PATH_SEARCH_RUNNING) {
+            if (!wait_for_budget(system)) break;
+            if (is_cancelled(system, slot)) break;
+            int slice = take_slice(system);
+            system->busy++;
+            SDL_UnlockMutex(system->lock);
+
+            int expanded = pathfinding_last_expanded(worker->ctx);
+            status = pathfinding_search_step(worker->ctx, &system->map, slice, &result);
+            int unused = slice - (pathfinding_last_expanded(worker->ctx) - expanded);
+
+            SDL_LockMutex(system->lock);
+            system->busy--;
+            system->budget += unused;
+        }
+        TRACE_END_ARGS("path query", "expanded", pathfinding_last_expanded(worker->ctx), "found", status == PATH_SEARCH_FOUND);
+
+        if (system->quit) break;
+        system->running--;
+        if (system->slots[slot].state == SLOT_CANCELLED) {
+            release_slot(system, slot);
+        } else {
+            system->slots[slot].path = result;
+            system->slots[slot].state = status == PATH_SEARCH_FOUND ? SLOT_DONE : SLOT_FAILED;
+        }
+        SDL_BroadcastCondition(system->finished);
+        // In a blocking run the next search was waiting for this one
+        SDL_BroadcastCondition(system->wake);
+    }
+    SDL_UnlockMutex(system->lock);
+    return 0;
+}
+
+PathJobSystem* pathjobs_create(const Map* map, int worker_count) {
+    // Every worker owns an arena as large as the map, on a big level the
+    // memory decides how many there are
+    const size_t arena_bytes = pathfinding_context_bytes(map);
+    const size_t affordable = arena_bytes > 0 ? MAX_PATH_ARENA_BYTES / arena_bytes : (size_t)worker_count;
+    if ((size_t)worker_count > affordable) worker_count = (int)affordable;
+    if (worker_count < 1) worker_count = 1;
+
+    PathJobSystem* system = (PathJobSystem*)calloc(1, sizeof(PathJobSystem));
+    if (!system) return NULL;
+    system->map = *map;
+    system->free_head = -1;
+    system->queue_head = -1;
+    system->queue_tail = -1;
+    system->lock = SDL_CreateMutex();
+    system->wake = SDL_CreateCondition();
+    system->finished = SDL_CreateCondition();
+    system->budget = PATH_EXPANSIONS_PER_TICK;
+    system->tick_start_budget = PATH_EXPANSIONS_PER_TICK;
+    system->workers = (PathWorker*)calloc(worker_count, sizeof(PathWorker));
+    if (!system->lock || !system->wake || !system->finished || !system->workers) {
+        pathjobs_destroy(system);
+        return NULL;
+    }
+
+    // The arenas come first, so a level too big for them is known before
+    // any thread runs. The workers that got one still start
+    int arena_count = 0;
+    while (arena_count < worker_count) {
+        PathWorker* worker = &system->workers[arena_count];
+        worker->system = system;
+        worker->ctx = pathfinding_context_create(map);
+        if (!worker->ctx) {
+            printf("Error: Could not allocate the %zu MB search arena of pathfinding worker %d\n",
+                   arena_bytes >> 20, arena_count + 1);
+            break;
+        }
+        arena_count++;
+    }
+
+    for (int i = 0; i < arena_count; i++) {
+        PathWorker* worker = &system->workers[i];
+        worker->thread = SDL_CreateThread(worker_main, "pathfinding", worker);
+        if (!worker->thread) {
+            printf("Error: Could not start pathfinding worker %d: %s\n", i + 1, SDL_GetError());
+            break;
+        }
+        system->worker_count++;
+    }
+    // Arenas of the workers that didn't start, pathjobs_destroy only knows the others
+    for (int i = system->worker_count; i < arena_count; i++) {
+        pathfinding_context_destroy(system->workers[i].ctx);
+        system->workers[i].ctx = NULL;
+    }
+
+    if (system->worker_count == 0) {
+        printf("Error: Could not start any pathfinding worker\n");
+        pathjobs_destroy(system);
+        return NULL;
+    }
+    printf("[PATH] Started %d pathfinding workers, %zu KB of search arenas\n",
+           system->worker_count, (arena_bytes * system->worker_count) >> 10);
+    return system;
+}
+
+void pathjobs_destroy(PathJobSystem* system) {
+    if (!system) return;
+
+    if (system->lock) {
+        SDL_LockMutex(system->lock);
+        system->quit = true;
+        SDL_BroadcastCondition(system->wake);
+        SDL_UnlockMutex(system->lock);
+    }
+    for (int i = 0; i < system->worker_count; i++) {
+        SDL_WaitThread(system->workers[i].thread, NULL);
+        pathfinding_context_destroy(system->workers[i].ctx);
+    }
+
+    free(system->workers);
+    free(system->slots);
+    free(system->order);
+    SDL_DestroyCondition(system->wake);
+    SDL_DestroyCondition(system->finished);
+    SDL_DestroyMutex(system->lock);
+    free(system);
+}
+
+PathJobHandle pathjobs_submit(PathJobSystem* system, uint32_t key, Vector2f start_pos, Vector2f end_pos) {
+    SDL_LockMutex(system->lock);
+
+    if (system->free_head == -1) {
+        int new_count = system->slot_count ? system->slot_count * 2 : 64;
+        PathJobSlot* slots = (PathJobSlot*)realloc(system->slots, new_count * sizeof(PathJobSlot));
+        if (slots) system->slots = slots;
+        PathJobOrder* order = (PathJobOrder*)realloc(system->order, new_count * sizeof(PathJobOrder));
+        if (order) system->order = order;
+        if (!slots || !order) {
+            SDL_UnlockMutex(system->lock);
+            return PATH_JOB_NONE;
+        }
+        for (int i = new_count - 1; i >= system->slot_count; i--) {
+            system->slots[i].state = SLOT_FREE;
+            system->slots[i].generation = 1;
+            system->slots[i].next = system->free_head;
+            system->free_head = i;
+        }
+        system->slot_count = new_count;
+    }
+
+    int slot = system->free_head;
+    system->free_head = system->slots[slot].next;
+
+    PathJobSlot* job = &system->slots[slot];
+    job->state = SLOT_QUEUED;
+    job->start = start_pos;
+    job->end = end_pos;
+    job->next = -1;
+    job->tick = system->tick;
+    job->key = key;
+    job->sequence = system->sequence++;
+    if (system->queue_tail == -1) {
+        system->queue_head = slot;
+    } else {
+        system->slots[system->queue_tail].next = slot;
+    }
+    system->queue_tail = slot;
+
+    PathJobHandle handle = make_handle(slot, job->generation);
+    SDL_BroadcastCondition(system->wake);
+    SDL_UnlockMutex(system->lock);
+    return handle;
+}
+
+PathJobStatus pathjobs_poll(PathJobSystem* system, PathJobHandle handle, Path** out) {
+    PathJobStatus status = PATH_JOB_INVALID;
+    Path* path = NULL;
+
+    SDL_LockMutex(system->lock);
+    int slot = slot_from_handle(system, handle);
+    if (slot >= 0 && system->blocking) {
+        while ((system->slots[slot].state == SLOT_QUEUED || system->slots[slot].state == SLOT_RUNNING)
+                && !is_settled(system)) {
+            SDL_WaitCondition(system->finished, system->lock);
+        }
+    }
+    if (slot >= 0) {
+        switch (system->slots[slot].state) {
+            case SLOT_DONE:
+                path = (Path*)malloc(sizeof(Path));
+                if (path) *path = system->slots[slot].path;
+                status = path ? PATH_JOB_DONE : PATH_JOB_FAILED;
+                release_slot(system, slot);
+                break;
+            case SLOT_FAILED:
+                status = PATH_JOB_FAILED;
+                release_slot(system, slot);
+                break;
+            case SLOT_QUEUED:
+            case SLOT_RUNNING:
+                status = PATH_JOB_PENDING;
+                break;
+            default:
+                break;
+        }
+    }
+    SDL_UnlockMutex(system->lock);
+
+    if (out) *out = path;
+    return status;
+}
+
+void pathjobs_set_blocking(PathJobSystem* system, bool blocking) {
+    SDL_LockMutex(system->lock);
+    system->blocking = blocking;
+    SDL_BroadcastCondition(system->wake);
+    SDL_UnlockMutex(system->lock);
+}
+
+void pathjobs_begin_tick(PathJobSystem* system) {
+    SDL_LockMutex(system->lock);
+    if (system->blocking) {
+        // The last tick's budget goes where it would have gone however fast
+        // the workers are, then the searches it didn't reach are lined up
+        while (!is_settled(system)) {
+            SDL_WaitCondition(system->finished, system->lock);
+        }
+        sort_queue(system);
+    }
+    system->tick_expanded = system->tick_start_budget - system->budget;
+    system->tick++;
+    // What wasn't spent is gone, what was overdrawn is paid back first
+    system->budget = SDL_min(system->budget, 0) + PATH_EXPANSIONS_PER_TICK;
+    system->tick_start_budget = system->budget;
+    SDL_BroadcastCondition(system->wake);
+    SDL_UnlockMutex(system->lock);
+}
+
+int pathjobs_tick_expansions(PathJobSystem* system) {
+    SDL_LockMutex(system->lock);
+    int expanded = system->tick_expanded;
+    SDL_UnlockMutex(system->lock);
+    return expanded;
+}
+
+void pathjobs_cancel(PathJobSystem* system, PathJobHandle handle) {
+    SDL_LockMutex(system->lock);
+    int slot = slot_from_handle(system, handle);
+    if (slot >= 0) {
+        switch (system->slots[slot].state) {
+            case SLOT_QUEUED:
+            case SLOT_RUNNING:
+                // The worker that picks it up (or finishes it) frees the slot
+                system->slots[slot].state = SLOT_CANCELLED;
+                system->slots[slot].cancel_tick = system->tick;
+                break;
+            case SLOT_DONE:
+            case SLOT_FAILED:
+                release_slot(system, slot);
+                break;
+            default:
+                break;
+        }
+    }
+    SDL_UnlockMutex(system->lock);
+}
@@ -0,0 +1,77 @@
+#ifndef PATHJOBS_H
+#define PATHJOBS_H
+
+/// Asynchronous path requests
+/// Searches are queued from the game loop and run on a pool of worker threads,
+/// each with its own search arena. The game polls the handle on later ticks and
+/// keeps doing whatever it was doing until the result shows up, so an expensive
+/// search never stalls a frame.
+///
+/// The workers run each search in slices of PATH_SEARCH_SLICE expansions
+/// drawn from a budget of PATH_EXPANSIONS_PER_TICK shared by all of them.
+/// pathjobs_begin_tick refills it, once it runs dry the workers wait for the
+/// next tick with their searches parked in their arenas. A target that can't
+/// be reached then costs its region spread over several ticks instead of all
+/// at once, and a search cancelled meanwhile stops at the end of its slice.
+/// Hierarchical queries can't be split, they run whole and are charged after,
+/// what they overdraw is taken off the next tick so the cap holds on average
+
+#include <stdint.h>
+#include "../map/map.h"
+#include "vector.h"
+#include "pathfinding.h"
+
+#define PATH_JOB_NONE 0
+
+// Expansions all the workers together may do per tick
+#define PATH_EXPANSIONS_PER_TICK 16384
+
+typedef uint64_t PathJobHandle;
+
+typedef enum {
+    PATH_JOB_PENDING,  // Queued or being searched
+    PATH_JOB_DONE,     // A path was found, ownership goes to the caller
+    PATH_JOB_FAILED,   // No path exists
+    PATH_JOB_INVALID,  // Unknown or already collected handle
+} PathJobStatus;
+
+typedef struct PathJobSystem PathJobSystem;
+
+// Starts up to worker_count workers, fewer when their arenas would take more
+// than MAX_PATH_ARENA_BYTES, but always one. Returns NULL when not even one
+// arena could be allocated. The map's navigation data (cost field, hierarchy)
+// must not change while the system is alive, the workers read it without locking
+PathJobSystem* pathjobs_create(const Map* map, int worker_count);
+
+// Stops the workers and drops every pending request
+void pathjobs_destroy(PathJobSystem* system);
+
+// Queues a search, never blocks on the search itself. key orders the searches
+// submitted on the same tick in a blocking run, give every caller its own
+// (an enemy passes its index). Returns PATH_JOB_NONE when out of memory
+PathJobHandle pathjobs_submit(PathJobSystem* system, uint32_t key, Vector2f start_pos, Vector2f end_pos);
+
+// Checks a request. On PATH_JOB_DONE *out receives a path to free with
+// path_destroy, on PATH_JOB_FAILED it receives NULL. Both release the handle
+PathJobStatus pathjobs_poll(PathJobSystem* system, PathJobHandle handle, Path** out);
+
+// Makes the results depend on the tick only, whatever the thread timing was,
+// which is what reproducible runs need. Searches submitted on a tick are
+// sorted by key at the start of the next one, and the budget of every tick
+// goes to them one after the other in that order. pathjobs_poll waits until
+// the search is done or this tick's budget can't reach it anymore, and
+// cancels take effect on the next tick. The searches still run on a worker,
+// one at a time, in parallel with the game loop
+void pathjobs_set_blocking(PathJobSystem* system, bool blocking);
+
+// Refills the expansion budget, call once at the start of every tick. In a
+// blocking run it first waits for the last tick's budget to be spent
+void pathjobs_begin_tick(PathJobSystem* system);
+
+// Expansions charged over the last whole tick, HPA overdraws included
+int pathjobs_tick_expansions(PathJobSystem* system);
+
+// Forgets a request, its result is thrown away when the worker finishes
+void pathjobs_cancel(PathJobSystem* system, PathJobHandle handle);
+
+#endif // PATHJOBS_H
@@ -0,0 +1,80 @@
+// stalker-c/helper/profiler.c
+
+#include "profiler.h"
+#include <stdlib.h>
+
+// Running totals for the frame in progress, in nanoseconds. Workers add to
+// them too, hence the atomics. An int holds a bit over 2 s per zone per frame
+static SDL_AtomicInt frame_totals[PROFILE_ZONE_COUNT];
+
+// Finished frames, history[frame][zone] in milliseconds
+static float history[PROFILER_HISTORY][PROFILE_ZONE_COUNT];
+static int history_head = 0;  // Slot the next frame goes into
+static int history_count = 0;
+
+static const char* zone_names[PROFILE_ZONE_COUNT] = {
+    [PROFILE_ZONE_FRAME] = "frame",
+    [PROFILE_ZONE_PLAYER] = "player",
+    [PROFILE_ZONE_FLOWFIELD] = "flowfield",
+    [PROFILE_ZONE_VISIBILITY] = "visibility",
+    [PROFILE_ZONE_ENEMIES] = "enemies",
+    [PROFILE_ZONE_PATHFINDING] = "pathfind",
+    [PROFILE_ZONE_LOS] = "los",
+    [PROFILE_ZONE_MAP_RENDER] = "map draw",
+    [PROFILE_ZONE_ENTITY_RENDER] = "entity draw",
+    [PROFILE_ZONE_TEXT] = "text",
+    [PROFILE_ZONE_PRESENT] = "present",
+};
+
+void profiler_record(ProfileZone zone, Uint64 elapsed_ns) {
+    SDL_AddAtomicInt(&frame_totals[zone], (int)elapsed_ns);
+}
+
+void profiler_frame_end() {
+    float* frame = history[history_head];
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        frame[zone] = (unsigned int)SDL_SetAtomicInt(&frame_totals[zone], 0) / 1e6f;
+    }
+    history_head = (history_head + 1) % PROFILER_HISTORY;
+    if (history_count < PROFILER_HISTORY) history_count++;
+}
+
+const char* profiler_zone_name(ProfileZone zone) {
+    return zone_names[zone];
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+void profiler_get_stats(ProfileZone zone, ProfileStats* stats) {
+    stats->average_ms = 0.0f;
+    stats->p99_ms = 0.0f;
+    stats->last_ms = 0.0f;
+    if (history_count == 0) return;
+
+    float sorted[PROFILER_HISTORY];
+    float sum = 0.0f;
+    for (int i = 0; i < history_count; i++) {
+        sorted[i] = history[i][zone];
+        sum += sorted[i];
+    }
+    qsort(sorted, history_count, sizeof(float), compare_floats);
+
+    int last = (history_head + PROFILER_HISTORY - 1) % PROFILER_HISTORY;
+    stats->average_ms = sum / history_count;
+    stats->p99_ms = sorted[(history_count * 99) / 100];
+    stats->last_ms = history[last][zone];
+}
+
+int profiler_frame_history(float* out_ms, int count) {
+    if (count > history_count) count = history_count;
+    // The oldest of the last count frames
+    int first = (history_head + PROFILER_HISTORY - count) % PROFILER_HISTORY;
+    for (int i = 0; i < count; i++) {
+        out_ms[i] = history[(first + i) % PROFILER_HISTORY][PROFILE_ZONE_FRAME];
+    }
+    return count;
+}
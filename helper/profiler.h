@@ -0,0 +1,63 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/// Frame profiler
+/// Code is timed with PROFILE_BEGIN / PROFILE_END pairs around a stage, every
+/// pair adds its time to the zone's total for the current frame. Zones can be
+/// entered many times per frame and from any thread, pathfinding workers
+/// included. profiler_frame_end moves the totals into a ring buffer holding the
+/// last PROFILER_HISTORY frames, the averages and p99 are taken from there.
+///
+/// Building with -DPROFILING=0 removes every zone from the code
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef PROFILING
+#define PROFILING 1
+#endif
+
+#define PROFILER_HISTORY 256 // Frames kept in the ring buffer
+
+typedef enum {
+    PROFILE_ZONE_FRAME,         // SDL_AppIterate from start to end
+    PROFILE_ZONE_PLAYER,        // player_update
+    PROFILE_ZONE_FLOWFIELD,     // flowfield_update
+    PROFILE_ZONE_VISIBILITY,    // visibility_update
+    PROFILE_ZONE_ENEMIES,       // enemy_store_update, think and apply
+    PROFILE_ZONE_PATHFINDING,   // Every search, summed over the worker threads
+    PROFILE_ZONE_LOS,           // Every line of sight test
+    PROFILE_ZONE_MAP_RENDER,    // map_render
+    PROFILE_ZONE_ENTITY_RENDER, // Queueing and flushing the entity batch
+    PROFILE_ZONE_TEXT,          // Every text draw
+    PROFILE_ZONE_PRESENT,       // SDL_RenderPresent
+    PROFILE_ZONE_COUNT,
+} ProfileZone;
+
+typedef struct {
+    float average_ms; // Mean time per frame over the history
+    float p99_ms;     // 99th percentile time per frame over the history
+    float last_ms;    // Last finished frame
+} ProfileStats;
+
+#if PROFILING
+#define PROFILE_BEGIN(zone) const Uint64 profile_start_##zone = SDL_GetTicksNS()
+#define PROFILE_END(zone) profiler_record((zone), SDL_GetTicksNS() - profile_start_##zone)
+#else
+#define PROFILE_BEGIN(zone) ((void)0)
+#define PROFILE_END(zone) ((void)0)
+#endif
+
+// Adds elapsed_ns to the zone for the current frame, safe from any thread
+void profiler_record(ProfileZone zone, Uint64 elapsed_ns);
+// Closes the current frame, call once per frame from the main thread
+void profiler_frame_end();
+
+const char* profiler_zone_name(ProfileZone zone);
+// Fills stats for one zone from the frames recorded so far
+void profiler_get_stats(ProfileZone zone, ProfileStats* stats);
+// Copies up to count frame times in ms, oldest first. Returns how many it copied
+int profiler_frame_history(float* out_ms, int count);
+
+#endif // PROFILER_H
@@ -0,0 +1,206 @@
+// stalker-c/helper/render_batch.c
+
+#include "render_batch.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef enum {
+    BATCH_RECTS,
+    BATCH_FILL_RECTS,
+    BATCH_LINES,
+} BatchKind;
+
+// Everything of one kind and colour. Lines are stored as two points each
+typedef struct {
+    BatchKind kind;
+    SDL_Color color;
+    SDL_FRect* rects;
+    SDL_FPoint* points;
+    int count;
+    int rect_capacity;   // Slots are reused across frames by any kind, so
+    int line_capacity;   // each array keeps its own capacity
+} BatchBucket;
+
+#define RENDER_BATCH_MAX_BUCKETS 32
+
+struct RenderBatch {
+    SDL_Renderer* renderer;
+    SDL_FRect camera;
+    BatchBucket buckets[RENDER_BATCH_MAX_BUCKETS];
+    int bucket_count;
+    SDL_Vertex* vertices;      // Scratch for line geometry
+    int* indices;
+    int geometry_capacity;
+    int draw_calls;
+    int last_frame_draw_calls;
+};
+
+RenderBatch* render_batch_create(SDL_Renderer* renderer) {
+    RenderBatch* batch = (RenderBatch*)calloc(1, sizeof(RenderBatch));
+    if (!batch) return NULL;
+    batch->renderer = renderer;
+    return batch;
+}
+
+void render_batch_destroy(RenderBatch* batch) {
+    if (batch) {
+        for (int i = 0; i < RENDER_BATCH_MAX_BUCKETS; i++) {
+            free(batch->buckets[i].rects);
+            free(batch->buckets[i].points);
+        }
+        free(batch->vertices);
+        free(batch->indices);
+        free(batch);
+    }
+}
+
+void render_batch_begin(RenderBatch* batch, const SDL_FRect* camera) {
+    batch->last_frame_draw_calls = batch->draw_calls;
+    batch->draw_calls = 0;
+    batch->camera = *camera;
+    for (int i = 0; i < batch->bucket_count; i++) batch->buckets[i].count = 0;
+}
+
+bool render_batch_visible(const RenderBatch* batch, const SDL_FRect* world_rect) {
+    return world_rect->x + world_rect->w >= batch->camera.x
+        && world_rect->y + world_rect->h >= batch->camera.y
+        && world_rect->x <= batch->camera.x + batch->camera.w
+        && world_rect->y <= batch->camera.y + batch->camera.h;
+}
+
+/// Finds the bucket for this kind and colour, with room for one more shape
+/// A frame only uses a handful of colours, so a linear search is plenty
+static BatchBucket* bucket_for(RenderBatch* batch, BatchKind kind, SDL_Color color) {
+    BatchBucket* bucket = NULL;
+    for (int i = 0; i < batch->bucket_count; i++) {
+        BatchBucket* candidate = &batch->buckets[i];
+        if (candidate->kind == kind && candidate->color.r == color.r && candidate->color.g == color.g
+                && candidate->color.b == color.b && candidate->color.a == color.a) {
+            bucket = candidate;
+            break;
+        }
+    }
+    if (!bucket) {
+        // Out of buckets, send what we have so the slots can be reused
+        if (batch->bucket_count == RENDER_BATCH_MAX_BUCKETS) render_batch_flush(batch);
+        bucket = &batch->buckets[batch->bucket_count++];
+        bucket->kind = kind;
+        bucket->color = color;
+        bucket->count = 0;
+    }
+
+    if (kind == BATCH_LINES && bucket->count == bucket->line_capacity) {
+        int capacity = bucket->line_capacity ? bucket->line_capacity * 2 : 64;
+        SDL_FPoint* points = (SDL_FPoint*)realloc(bucket->points, capacity * 2 * sizeof(SDL_FPoint));
+        if (!points) return NULL;
+        bucket->points = points;
+        bucket->line_capacity = capacity;
+    } else if (kind != BATCH_LINES && bucket->count == bucket->rect_capacity) {
+        int capacity = bucket->rect_capacity ? bucket->rect_capacity * 2 : 64;
+        SDL_FRect* rects = (SDL_FRect*)realloc(bucket->rects, capacity * sizeof(SDL_FRect));
+        if (!rects) return NULL;
+        bucket->rects = rects;
+        bucket->rect_capacity = capacity;
+    }
+    return bucket;
+}
+
+void render_batch_rect(RenderBatch* batch, const SDL_FRect* rect, SDL_Color color) {
+    BatchBucket* bucket = bucket_for(batch, BATCH_RECTS, color);
+    if (bucket) bucket->rects[bucket->count++] = *rect;
+}
+
+void render_batch_fill_rect(RenderBatch* batch, const SDL_FRect* rect, SDL_Color color) {
+    BatchBucket* bucket = bucket_for(batch, BATCH_FILL_RECTS, color);
+    if (bucket) bucket->rects[bucket->count++] = *rect;
+}
+
+void render_batch_line(RenderBatch* batch, float x1, float y1, float x2, float y2, SDL_Color color) {
+    BatchBucket* bucket = bucket_for(batch, BATCH_LINES, color);
+    if (bucket) {
+        bucket->points[bucket->count * 2] = (SDL_FPoint){ x1, y1 };
+        bucket->points[bucket->count * 2 + 1] = (SDL_FPoint){ x2, y2 };
+        bucket->count++;
+    }
+}
+
+/// Separate segments cannot go through one SDL_RenderLines call, so they are
+/// turned into one pixel wide quads and sent as a single geometry call
+static void flush_lines(RenderBatch* batch, const BatchBucket* bucket) {
+    int vertex_count = bucket->count * 4;
+    if (vertex_count > batch->geometry_capacity) {
+        SDL_Vertex* vertices = (SDL_Vertex*)realloc(batch->vertices, vertex_count * sizeof(SDL_Vertex));
+        int* indices = (int*)realloc(batch->indices, bucket->count * 6 * sizeof(int));
+        if (vertices) batch->vertices = vertices;
+        if (indices) batch->indices = indices;
+        if (!vertices || !indices) return;
+        batch->geometry_capacity = vertex_count;
+    }
+
+    SDL_FColor color = {
+        bucket->color.r / 255.0f, bucket->color.g / 255.0f, bucket->color.b / 255.0f, bucket->color.a / 255.0f
+    };
+    for (int i = 0; i < bucket->count; i++) {
+        SDL_FPoint a = bucket->points[i * 2];
+        SDL_FPoint b = bucket->points[i * 2 + 1];
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float length = sqrtf(dx * dx + dy * dy);
+        // Half a pixel to each side of the segment
+        float nx = length > 0.0f ? -dy / length * 0.5f : 0.5f;
+        float ny = length > 0.0f ? dx / length * 0.5f : 0.0f;
+
+        SDL_Vertex* v = &batch->vertices[i * 4];
+        v[0] = (SDL_Vertex){ { a.x + nx, a.y + ny }, color, { 0, 0 } };
+        v[1] = (SDL_Vertex){ { a.x - nx, a.y - ny }, color, { 0, 0 } };
+        v[2] = (SDL_Vertex){ { b.x + nx, b.y + ny }, color, { 0, 0 } };
+        v[3] = (SDL_Vertex){ { b.x - nx, b.y - ny }, color, { 0, 0 } };
+
+        int* index = &batch->indices[i * 6];
+        index[0] = i * 4;
+        index[1] = i * 4 + 1;
+        index[2] = i * 4 + 2;
+        index[3] = i * 4 + 1;
+        index[4] = i * 4 + 3;
+        index[5] = i * 4 + 2;
+    }
+    SDL_RenderGeometry(batch->renderer, NULL, batch->vertices, vertex_count, batch->indices, bucket->count * 6);
+}
+
+void render_batch_flush(RenderBatch* batch) {
+    for (int i = 0; i < batch->bucket_count; i++) {
+        BatchBucket* bucket = &batch->buckets[i];
+        if (bucket->count == 0) continue;
+
+        SDL_SetRenderDrawColor(batch->renderer, bucket->color.r, bucket->color.g, bucket->color.b, bucket->color.a);
+        switch (bucket->kind) {
+            case BATCH_RECTS:
+                SDL_RenderRects(batch->renderer, bucket->rects, bucket->count);
+                break;
+            case BATCH_FILL_RECTS:
+                SDL_RenderFillRects(batch->renderer, bucket->rects, bucket->count);
+                break;
+            case BATCH_LINES:
+                flush_lines(batch, bucket);
+                break;
+        }
+        batch->draw_calls++;
+        bucket->count = 0;
+    }
+    // Buckets are kept with their memory, the colour order restarts
+    batch->bucket_count = 0;
+}
+
+void render_batch_count_draws(RenderBatch* batch, int draw_calls) {
+    batch->draw_calls += draw_calls;
+}
+
+int render_batch_draw_calls(const RenderBatch* batch) {
+    return batch->draw_calls;
+}
+
+int render_batch_last_frame_draw_calls(const RenderBatch* batch) {
+    return batch->last_frame_draw_calls;
+}
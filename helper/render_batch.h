@@ -0,0 +1,51 @@
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+/// Batched 2D draw submission
+/// Rects, filled rects and lines are collected per colour during the frame and
+/// sent with one SDL call per colour and kind on render_batch_flush, instead of
+/// one SDL_SetRenderDrawColor plus one draw per shape. Shapes of the same kind
+/// and colour keep their order, different colours are drawn in the order the
+/// colour was first used this frame.
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+
+typedef struct RenderBatch RenderBatch;
+
+RenderBatch* render_batch_create(SDL_Renderer* renderer);
+void render_batch_destroy(RenderBatch* batch);
+
+// Starts a frame. The camera (world coordinates) is used for culling
+void render_batch_begin(RenderBatch* batch, const SDL_FRect* camera);
+
+// True if a world space rect overlaps the camera, anything else can be skipped
+bool render_batch_visible(const RenderBatch* batch, const SDL_FRect* world_rect);
+
+// Where a moving rect is drawn, alpha of the way from its previous tick to its current one
+static inline SDL_FRect render_lerp_rect(const SDL_FRect* previous, const SDL_FRect* current, float alpha) {
+    return (SDL_FRect){
+        previous->x + (current->x - previous->x) * alpha,
+        previous->y + (current->y - previous->y) * alpha,
+        current->w,
+        current->h
+    };
+}
+
+// Shapes are in screen coordinates, the same ones SDL_RenderRect takes
+void render_batch_rect(RenderBatch* batch, const SDL_FRect* rect, SDL_Color color);
+void render_batch_fill_rect(RenderBatch* batch, const SDL_FRect* rect, SDL_Color color);
+void render_batch_line(RenderBatch* batch, float x1, float y1, float x2, float y2, SDL_Color color);
+
+// Submits everything queued so far, can be called more than once per frame to
+// keep the layering with things drawn outside the batch
+void render_batch_flush(RenderBatch* batch);
+
+// For draws made outside the batch (map chunks, text), so the count is complete
+void render_batch_count_draws(RenderBatch* batch, int draw_calls);
+
+// Draw calls made since render_batch_begin / during the previous frame
+int render_batch_draw_calls(const RenderBatch* batch);
+int render_batch_last_frame_draw_calls(const RenderBatch* batch);
+
+#endif // RENDER_BATCH_H
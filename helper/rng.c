@@ -0,0 +1,28 @@
+// stalker-c/helper/rng.c
+
+#include "rng.h"
+
+// The seed goes through one splitmix64 round so nearby seeds (enemy streams
+// are seeded with seed + index) start far apart
+void rng_seed(Rng* rng, uint64_t seed) {
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    // xorshift never leaves the all zero state
+    rng->state = z ? z : 0x9e3779b97f4a7c15ULL;
+}
+
+// xorshift64*, returns the high half which has the best bits
+uint32_t rng_next(Rng* rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return (uint32_t)((x * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+int rng_range(Rng* rng, int bound) {
+    return (int)(((uint64_t)rng_next(rng) * (uint32_t)bound) >> 32);
+}
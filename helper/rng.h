@@ -0,0 +1,23 @@
+#ifndef RNG_H
+#define RNG_H
+
+/// Seedable random numbers
+/// Everything random in the game draws from an explicit Rng instead of rand(),
+/// so a run started with the same seed and the same input makes the same
+/// decisions. Each enemy owns its own stream, the order enemies are updated in
+/// doesn't change what any of them rolls
+
+#include <stdint.h>
+
+typedef struct Rng {
+    uint64_t state;
+} Rng;
+
+// Any seed is fine, including 0 and seeds that differ by one
+void rng_seed(Rng* rng, uint64_t seed);
+// Uniform over the full 32 bits
+uint32_t rng_next(Rng* rng);
+// Uniform in [0, bound), bound must be positive
+int rng_range(Rng* rng, int bound);
+
+#endif // RNG_H
@@ -0,0 +1,148 @@
+// stalker-c/helper/spatial_grid.c
+
+#include "spatial_grid.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+SpatialGrid* spatial_grid_create(const Map* map, int cell_tiles) {
+    SpatialGrid* grid = (SpatialGrid*)calloc(1, sizeof(SpatialGrid));
+    if (!grid) return NULL;
+
+    grid->cell_size = (float)(cell_tiles * TILE_SIZE);
+    grid->cells_x = (map->width + cell_tiles - 1) / cell_tiles;
+    grid->cells_y = (map->height + cell_tiles - 1) / cell_tiles;
+    grid->cell_head = (int*)malloc((size_t)grid->cells_x * grid->cells_y * sizeof(int));
+    if (!grid->cell_head) {
+        printf("Error: Could not allocate a %dx%d spatial grid\n", grid->cells_x, grid->cells_y);
+        free(grid);
+        return NULL;
+    }
+    for (int i = 0; i < grid->cells_x * grid->cells_y; i++) {
+        grid->cell_head[i] = -1;
+    }
+    return grid;
+}
+
+void spatial_grid_destroy(SpatialGrid* grid) {
+    if (!grid) return;
+    free(grid->cell_head);
+    free(grid->next);
+    free(grid->prev);
+    free(grid->cell);
+    free(grid->pos);
+    free(grid);
+}
+
+bool spatial_grid_reserve(SpatialGrid* grid, int capacity) {
+    if (capacity <= grid->capacity) return true;
+
+    int* next = (int*)realloc(grid->next, capacity * sizeof(int));
+    if (next) grid->next = next;
+    int* prev = (int*)realloc(grid->prev, capacity * sizeof(int));
+    if (prev) grid->prev = prev;
+    int* cell = (int*)realloc(grid->cell, capacity * sizeof(int));
+    if (cell) grid->cell = cell;
+    Vector2f* pos = (Vector2f*)realloc(grid->pos, capacity * sizeof(Vector2f));
+    if (pos) grid->pos = pos;
+    if (!next || !prev || !cell || !pos) return false;
+
+    for (int id = grid->capacity; id < capacity; id++) {
+        grid->cell[id] = -1;
+    }
+    grid->capacity = capacity;
+    return true;
+}
+
+// Positions off the map go to the nearest edge cell
+static int cell_coord(float value, float cell_size, int cells) {
+    int coord = (int)SDL_floorf(value / cell_size);
+    if (coord < 0) return 0;
+    if (coord >= cells) return cells - 1;
+    return coord;
+}
+
+static int cell_at(const SpatialGrid* grid, Vector2f pos) {
+    return cell_coord(pos.y, grid->cell_size, grid->cells_y) * grid->cells_x
+        + cell_coord(pos.x, grid->cell_size, grid->cells_x);
+}
+
+static void grid_link(SpatialGrid* grid, int id, int cell) {
+    grid->cell[id] = cell;
+    grid->prev[id] = -1;
+    grid->next[id] = grid->cell_head[cell];
+    if (grid->next[id] >= 0) grid->prev[grid->next[id]] = id;
+    grid->cell_head[cell] = id;
+}
+
+static void grid_unlink(SpatialGrid* grid, int id) {
+    int cell = grid->cell[id];
+    if (grid->prev[id] >= 0) {
+        grid->next[grid->prev[id]] = grid->next[id];
+    } else {
+        grid->cell_head[cell] = grid->next[id];
+    }
+    if (grid->next[id] >= 0) grid->prev[grid->next[id]] = grid->prev[id];
+    grid->cell[id] = -1;
+}
+
+void spatial_grid_insert(SpatialGrid* grid, int id, Vector2f pos) {
+    if (id < 0 || id >= grid->capacity) return;
+    if (grid->cell[id] >= 0) grid_unlink(grid, id);
+    grid->pos[id] = pos;
+    grid_link(grid, id, cell_at(grid, pos));
+}
+
+void spatial_grid_move(SpatialGrid* grid, int id, Vector2f pos) {
+    grid->pos[id] = pos;
+    int cell = cell_at(grid, pos);
+    if (cell == grid->cell[id]) return;
+    if (grid->cell[id] >= 0) grid_unlink(grid, id);
+    grid_link(grid, id, cell);
+}
+
+void spatial_grid_remove(SpatialGrid* grid, int id) {
+    if (id < 0 || id >= grid->capacity || grid->cell[id] < 0) return;
+    grid_unlink(grid, id);
+}
+
+int spatial_grid_query_radius(const SpatialGrid* grid, Vector2f center, float radius, int* out, int capacity) {
+    const int x0 = cell_coord(center.x - radius, grid->cell_size, grid->cells_x);
+    const int x1 = cell_coord(center.x + radius, grid->cell_size, grid->cells_x);
+    const int y0 = cell_coord(center.y - radius, grid->cell_size, grid->cells_y);
+    const int y1 = cell_coord(center.y + radius, grid->cell_size, grid->cells_y);
+    const float radius_sq = radius * radius;
+
+    int found = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (int id = grid->cell_head[cy * grid->cells_x + cx]; id >= 0; id = grid->next[id]) {
+                float dx = grid->pos[id].x - center.x;
+                float dy = grid->pos[id].y - center.y;
+                if (dx * dx + dy * dy >= radius_sq) continue;
+                if (found < capacity) out[found] = id;
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+int spatial_grid_query_rect(const SpatialGrid* grid, const SDL_FRect* rect, int* out, int capacity) {
+    const int x0 = cell_coord(rect->x, grid->cell_size, grid->cells_x);
+    const int x1 = cell_coord(rect->x + rect->w, grid->cell_size, grid->cells_x);
+    const int y0 = cell_coord(rect->y, grid->cell_size, grid->cells_y);
+    const int y1 = cell_coord(rect->y + rect->h, grid->cell_size, grid->cells_y);
+
+    int found = 0;
+    for (int cy = y0; cy <= y1; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            for (int id = grid->cell_head[cy * grid->cells_x + cx]; id >= 0; id = grid->next[id]) {
+                Vector2f pos = grid->pos[id];
+                if (pos.x < rect->x || pos.x > rect->x + rect->w || pos.y < rect->y || pos.y > rect->y + rect->h) continue;
+                if (found < capacity) out[found] = id;
+                found++;
+            }
+        }
+    }
+    return found;
+}
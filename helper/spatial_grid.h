@@ -0,0 +1,53 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+/// Uniform grid over the map for proximity queries
+/// The map is cut into square cells of a few tiles, every entity sits in the
+/// cell under its position, linked into that cell's list. Moving an entity
+/// only relinks it when it crosses into another cell, so keeping the grid up
+/// to date costs a compare per move. A query walks the cells its area
+/// overlaps and tests the entities there, the rest of the map is never seen.
+///
+/// Entities are ids from 0 up to the reserved capacity, the index they have
+/// in whatever array their owner keeps them in. A grid holds one kind of
+/// entity, each owner keeps its own
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include "../map/map.h"
+#include "vector.h"
+
+// Cells are this many tiles across. Large enough that a perception or
+// interaction radius covers few cells, small enough that a cell holds few
+// entities even on crowded levels
+#define SPATIAL_GRID_CELL_TILES 4
+
+typedef struct SpatialGrid {
+    int cells_x;
+    int cells_y;
+    float cell_size;    // In pixels
+    int* cell_head;     // First entity of each cell, -1 when empty
+    int capacity;       // Ids below this can be used
+    int* next;          // Next entity in the same cell, -1 at the end
+    int* prev;          // Previous entity in the same cell, -1 at the start
+    int* cell;          // Cell the entity is linked into, -1 if not in the grid
+    Vector2f* pos;      // Position the entity was last inserted or moved to
+} SpatialGrid;
+
+SpatialGrid* spatial_grid_create(const Map* map, int cell_tiles);
+void spatial_grid_destroy(SpatialGrid* grid);
+// Makes ids up to capacity - 1 usable, the ones already in stay where they are
+bool spatial_grid_reserve(SpatialGrid* grid, int capacity);
+
+void spatial_grid_insert(SpatialGrid* grid, int id, Vector2f pos);
+// Updates the position, relinking only when the cell changed
+void spatial_grid_move(SpatialGrid* grid, int id, Vector2f pos);
+void spatial_grid_remove(SpatialGrid* grid, int id);
+
+// Entities closer than radius to center, or inside rect.
+// Up to capacity ids are written to out, the return value is how many matched,
+// which can be more. The order is by cell, not by id
+int spatial_grid_query_radius(const SpatialGrid* grid, Vector2f center, float radius, int* out, int capacity);
+int spatial_grid_query_rect(const SpatialGrid* grid, const SDL_FRect* rect, int* out, int capacity);
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,167 @@
+// stalker-c/helper/trace.c
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    Uint64 time_ns;
+    const char* name;
+    const char* keys[2];
+    int64_t values[2];
+    char phase;
+} TraceEvent;
+
+// One per thread. Only the owner writes events and count, the thread writing
+// the file reads count first and never looks past it
+typedef struct TraceBuffer {
+    struct TraceBuffer* next; // Set before the buffer is published, then fixed
+    int thread_index;
+    void* thread_name;        // const char*, see trace_name_thread
+    SDL_AtomicInt session;    // Trace the events belong to
+    SDL_AtomicInt count;
+    SDL_AtomicInt dropped;
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+} TraceBuffer;
+
+static void* buffer_list = NULL;       // TraceBuffer*, new buffers are pushed with a CAS
+static SDL_AtomicInt thread_counter;
+static SDL_AtomicInt active_session;   // 0 while no trace runs
+static int last_session = 0;
+static FILE* trace_file = NULL;
+static Uint64 trace_start_ns = 0;
+
+static _Thread_local TraceBuffer* thread_buffer = NULL;
+static _Thread_local const char* thread_name = NULL;
+
+static TraceBuffer* register_thread() {
+    TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+    if (!buffer) return NULL;
+    buffer->thread_index = SDL_AddAtomicInt(&thread_counter, 1) + 1;
+    buffer->thread_name = (void*)thread_name;
+
+    void* head;
+    do {
+        head = SDL_GetAtomicPointer(&buffer_list);
+        buffer->next = (TraceBuffer*)head;
+    } while (!SDL_CompareAndSwapAtomicPointer(&buffer_list, head, buffer));
+
+    thread_buffer = buffer;
+    return buffer;
+}
+
+void trace_record(char phase, const char* name, const char* key0, int64_t value0, const char* key1, int64_t value1) {
+    const int session = SDL_GetAtomicInt(&active_session);
+    if (session == 0) return;
+
+    TraceBuffer* buffer = thread_buffer ? thread_buffer : register_thread();
+    if (!buffer) return;
+    // First event of a new trace on this thread. The count is cleared before
+    // the session changes so the writer never pairs the new session with an
+    // old count
+    if (SDL_GetAtomicInt(&buffer->session) != session) {
+        SDL_SetAtomicInt(&buffer->count, 0);
+        SDL_SetAtomicInt(&buffer->dropped, 0);
+        SDL_SetAtomicInt(&buffer->session, session);
+    }
+
+    const int count = SDL_GetAtomicInt(&buffer->count);
+    if (count == TRACE_BUFFER_EVENTS) {
+        SDL_AddAtomicInt(&buffer->dropped, 1);
+        return;
+    }
+    TraceEvent* event = &buffer->events[count];
+    event->time_ns = SDL_GetTicksNS();
+    event->name = name;
+    event->keys[0] = key0;
+    event->values[0] = value0;
+    event->keys[1] = key1;
+    event->values[1] = value1;
+    event->phase = phase;
+    // Publishes the event, SDL atomics are full barriers
+    SDL_SetAtomicInt(&buffer->count, count + 1);
+}
+
+void trace_name_thread(const char* name) {
+    thread_name = name;
+    if (thread_buffer) SDL_SetAtomicPointer(&thread_buffer->thread_name, (void*)name);
+}
+
+bool trace_start(const char* path) {
+    if (trace_file) return false;
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        printf("Error: Could not create trace file %s\n", path);
+        return false;
+    }
+    trace_start_ns = SDL_GetTicksNS();
+    SDL_SetAtomicInt(&active_session, ++last_session);
+    printf("[TRACE] Recording to %s\n", path);
+    return true;
+}
+
+bool trace_is_running() {
+    return trace_file != NULL;
+}
+
+static void write_event(FILE* file, const TraceEvent* event, int tid, bool* first) {
+    double ts = event->time_ns >= trace_start_ns ? (event->time_ns - trace_start_ns) / 1000.0 : 0.0;
+    fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+            *first ? "" : ",\n", event->name, event->phase, ts, tid);
+    *first = false;
+
+    bool has_args = false;
+    for (int i = 0; i < 2; i++) {
+        if (!event->keys[i]) continue;
+        fprintf(file, "%s\"%s\":%lld", has_args ? "," : ",\"args\":{", event->keys[i], (long long)event->values[i]);
+        has_args = true;
+    }
+    fprintf(file, has_args ? "}}" : "}");
+}
+
+void trace_stop() {
+    if (!trace_file) return;
+    SDL_SetAtomicInt(&active_session, 0);
+
+    FILE* file = trace_file;
+    trace_file = NULL;
+    bool first = true;
+    long total = 0;
+    long dropped = 0;
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (TraceBuffer* buffer = (TraceBuffer*)SDL_GetAtomicPointer(&buffer_list); buffer; buffer = buffer->next) {
+        if (SDL_GetAtomicInt(&buffer->session) != last_session) continue;
+
+        const int count = SDL_GetAtomicInt(&buffer->count);
+        const char* name = (const char*)SDL_GetAtomicPointer(&buffer->thread_name);
+        if (name) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", buffer->thread_index, name);
+            first = false;
+        }
+        for (int i = 0; i < count; i++) {
+            write_event(file, &buffer->events[i], buffer->thread_index, &first);
+        }
+        total += count;
+
+        // Marks where the buffer ran out, at the time of its last event
+        const int lost = SDL_GetAtomicInt(&buffer->dropped);
+        if (lost > 0 && count > 0) {
+            TraceEvent marker = buffer->events[count - 1];
+            marker.name = "trace buffer full";
+            marker.phase = 'i';
+            marker.keys[0] = "dropped";
+            marker.values[0] = lost;
+            marker.keys[1] = NULL;
+            write_event(file, &marker, buffer->thread_index, &first);
+            dropped += lost;
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+
+    printf("[TRACE] Wrote %ld events", total);
+    if (dropped > 0) printf(", %ld dropped on full buffers", dropped);
+    printf("\n");
+}
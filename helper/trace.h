@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/// Event tracing to Chrome's trace format
+/// While a trace is running, TRACE_BEGIN / TRACE_END pairs record timestamped
+/// events with up to two integer annotations each (enemy index, AI state,
+/// nodes expanded...). trace_stop writes them as trace-event JSON, which
+/// chrome://tracing or ui.perfetto.dev open as a per-thread timeline.
+///
+/// Every thread writes into a buffer only it owns, recording an event is a
+/// few stores and one atomic publish, no lock is ever taken. A buffer that
+/// fills up drops further events and the drop count ends up in the file.
+/// Buffers are created the first time a thread records while a trace runs and
+/// are kept for the next trace.
+///
+/// Compiled out together with the profiler zones, see PROFILING
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "profiler.h"
+
+#define TRACE_BUFFER_EVENTS (1 << 16) // Per thread, per trace
+
+#if PROFILING
+#define TRACE_BEGIN(name) trace_record('B', (name), NULL, 0, NULL, 0)
+#define TRACE_END(name) trace_record('E', (name), NULL, 0, NULL, 0)
+// Annotations can go on either end, the viewer shows both sets
+#define TRACE_BEGIN_ARGS(name, key0, value0, key1, value1) trace_record('B', (name), (key0), (value0), (key1), (value1))
+#define TRACE_END_ARGS(name, key0, value0, key1, value1) trace_record('E', (name), (key0), (value0), (key1), (value1))
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_BEGIN_ARGS(name, key0, value0, key1, value1) ((void)0)
+#define TRACE_END_ARGS(name, key0, value0, key1, value1) ((void)0)
+#endif
+
+// Starts collecting, the file is created straight away so a bad path fails
+// here. Returns false if it can't be created or a trace is already running
+bool trace_start(const char* path);
+// Stops collecting and writes everything recorded to the file
+void trace_stop();
+bool trace_is_running();
+
+// Names the calling thread in the timeline, call it once from the thread
+void trace_name_thread(const char* name);
+
+// Names and keys must be string literals, only the pointers are stored.
+// A NULL key leaves that annotation out. Does nothing while no trace runs
+void trace_record(char phase, const char* name, const char* key0, int64_t value0, const char* key1, int64_t value1);
+
+#endif // TRACE_H
@@ -0,0 +1,130 @@
+// stalker-c/helper/visibility.c
+
+#include "visibility.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Turns the octant being scanned into map directions
+static const int octant_xx[8] = { 1, 0, 0, -1, -1, 0, 0, 1 };
+static const int octant_xy[8] = { 0, 1, -1, 0, 0, -1, 1, 0 };
+static const int octant_yx[8] = { 0, 1, 1, 0, 0, -1, -1, 0 };
+static const int octant_yy[8] = { 1, 0, 0, 1, -1, 0, 0, -1 };
+
+static size_t visibility_word_count(const VisibilityField* field) {
+    return (size_t)field->window * field->row_words;
+}
+
+// Only tiles within the radius of the origin are ever marked
+static void mark_visible(VisibilityField* field, int x, int y) {
+    int local_x = x - field->origin_x + field->radius;
+    int local_y = y - field->origin_y + field->radius;
+    field->bits[local_y * field->row_words + (local_x >> 6)] |= (uint64_t)1 << (local_x & 63);
+}
+
+/// Scans one octant row by row, starting at `row`, between the start and end
+/// slopes. Every wall met while the row is open splits the cone in two, the
+/// part before the wall is scanned recursively and the scan goes on past it
+static void cast_light(VisibilityField* field, const Map* map, int row, float start, float end, int octant) {
+    if (start < end) return;
+
+    const int xx = octant_xx[octant], xy = octant_xy[octant];
+    const int yx = octant_yx[octant], yy = octant_yy[octant];
+    const int radius_sq = field->radius * field->radius;
+    float new_start = 0.0f;
+
+    for (int distance = row; distance <= field->radius; distance++) {
+        bool blocked = false;
+        int dy = -distance;
+        for (int dx = -distance; dx <= 0; dx++) {
+            int x = field->origin_x + dx * xx + dy * xy;
+            int y = field->origin_y + dx * yx + dy * yy;
+            float left_slope = (dx - 0.5f) / (dy + 0.5f);
+            float right_slope = (dx + 0.5f) / (dy - 0.5f);
+
+            if (start < right_slope) continue;
+            if (end > left_slope) break;
+
+            // Walls light up as soon as any part of them is in view, open tiles
+            // only when their centre is, which keeps the field close to what a
+            // ray between the two tile centres would say
+            bool wall = map_is_wall(map, x, y);
+            float centre_slope = (float)dx / (float)dy;
+            bool lit = wall || (centre_slope <= start && centre_slope >= end);
+            if (lit && dx * dx + dy * dy <= radius_sq && x >= 0 && x < field->width && y >= 0 && y < field->height) {
+                mark_visible(field, x, y);
+            }
+
+            if (blocked) {
+                if (wall) {
+                    new_start = right_slope;
+                } else {
+                    blocked = false;
+                    start = new_start;
+                }
+            } else if (wall && distance < field->radius) {
+                blocked = true;
+                cast_light(field, map, distance + 1, start, left_slope, octant);
+                new_start = right_slope;
+            }
+        }
+        if (blocked) break;
+    }
+}
+
+VisibilityField* visibility_create(const Map* map, int radius) {
+    VisibilityField* field = (VisibilityField*)calloc(1, sizeof(VisibilityField));
+    if (!field) return NULL;
+
+    field->width = map->width;
+    field->height = map->height;
+    field->origin_x = -1;
+    field->origin_y = -1;
+    field->radius = radius;
+    field->window = 2 * radius + 1;
+    field->row_words = (field->window + 63) / 64;
+    field->bits = (uint64_t*)calloc(visibility_word_count(field), sizeof(uint64_t));
+
+    if (!field->bits) {
+        printf("Error: Could not allocate the visibility field\n");
+        visibility_destroy(field);
+        return NULL;
+    }
+    return field;
+}
+
+void visibility_destroy(VisibilityField* field) {
+    if (field) {
+        free(field->bits);
+        free(field);
+    }
+}
+
+bool visibility_update(VisibilityField* field, const Map* map, Vector2f origin_pos) {
+    int x = origin_pos.x / TILE_SIZE;
+    int y = origin_pos.y / TILE_SIZE;
+    if (x < 0 || x >= field->width || y < 0 || y >= field->height) return false;
+    if (x == field->origin_x && y == field->origin_y) return false;
+
+    field->origin_x = x;
+    field->origin_y = y;
+    field->rebuild_count++;
+
+    memset(field->bits, 0, visibility_word_count(field) * sizeof(uint64_t));
+    mark_visible(field, x, y);
+    for (int octant = 0; octant < 8; octant++) {
+        cast_light(field, map, 1, 1.0f, 0.0f, octant);
+    }
+    return true;
+}
+
+bool visibility_covers(const VisibilityField* field, Vector2f origin_pos, Vector2f pos) {
+    if (field->origin_x < 0
+            || (int)(origin_pos.x / TILE_SIZE) != field->origin_x
+            || (int)(origin_pos.y / TILE_SIZE) != field->origin_y) {
+        return false;
+    }
+    int dx = (int)(pos.x / TILE_SIZE) - field->origin_x;
+    int dy = (int)(pos.y / TILE_SIZE) - field->origin_y;
+    return dx * dx + dy * dy <= field->radius * field->radius;
+}
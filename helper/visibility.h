@@ -0,0 +1,55 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+/// Field of view around a single origin (the player)
+/// Recursive shadowcasting marks every tile visible from the origin tile in a
+/// bitset. It is only recomputed when the origin moves to another tile, after
+/// that "can this tile see the player" is a single bit lookup. The bitset only
+/// spans the square of tiles within the radius of the origin, a rebuild clears
+/// that much whatever the size of the map.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../map/map.h"
+#include "vector.h"
+
+// Radius in tiles. Tiles further away are not covered by the field and callers
+// fall back to map_has_line_of_sight
+#define VISIBILITY_DEFAULT_RADIUS 64
+
+typedef struct VisibilityField {
+    int width;
+    int height;
+    int origin_x;        // Origin tile, -1 before the first build
+    int origin_y;
+    int radius;
+    int window;          // Tiles per side of the square around the origin, 2 * radius + 1
+    int row_words;       // Words per row of the square
+    uint64_t* bits;      // One bit per tile of the square, row major
+    int rebuild_count;   // How many times the field was rebuilt, for profiling
+} VisibilityField;
+
+VisibilityField* visibility_create(const Map* map, int radius);
+void visibility_destroy(VisibilityField* field);
+
+// Moves the origin to the tile under origin_pos, recomputing only if that tile
+// changed. Returns true when a rebuild happened
+bool visibility_update(VisibilityField* field, const Map* map, Vector2f origin_pos);
+
+// True when the field is centred on origin_pos's tile and pos is inside the
+// radius, in which case visibility_can_see gives the answer
+bool visibility_covers(const VisibilityField* field, Vector2f origin_pos, Vector2f pos);
+
+static inline bool visibility_tile_visible(const VisibilityField* field, int x, int y) {
+    if (x < 0 || x >= field->width || y < 0 || y >= field->height) return false;
+    int local_x = x - field->origin_x + field->radius;
+    int local_y = y - field->origin_y + field->radius;
+    if (local_x < 0 || local_x >= field->window || local_y < 0 || local_y >= field->window) return false;
+    return (field->bits[local_y * field->row_words + (local_x >> 6)] >> (local_x & 63)) & 1;
+}
+
+static inline bool visibility_can_see(const VisibilityField* field, Vector2f pos) {
+    return visibility_tile_visible(field, (int)(pos.x / TILE_SIZE), (int)(pos.y / TILE_SIZE));
+}
+
+#endif // VISIBILITY_H
@@ -9,32 +9,64 @@
 #include <SDL3/SDL_main.h>
 #include <SDL3/SDL_video.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "defs/defs.h"
-#include "map/map.h"
-#include "player/player.h"
-#include "enemies/enemy.h"
-#include "npc/npc.h"
-#include "camera/camera.h"
 #include "game/game.h"
+#include "game/replay.h"
 #include "text/text.h"
 #include "dialogue/dialogue.h"
+#include "map/map_binary.h"
+#include "helper/render_batch.h"
+#include "helper/profiler.h"
+#include "helper/trace.h"
 
 
 // SDL variables
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
+static RenderBatch *render_batch = NULL;
+static bool show_render_stats = false;
+static bool show_profiler = false;
+static bool vsync_enabled = false;
 
-// Game variables
-GameState current_game_state;
-static Camera camera;
-Map current_level_map;
-Player player;
-Enemy enemies[MAX_ENEMIES];
-int active_enemy_count = 0;
-NPC npcs[MAX_NPCS];
-int active_npc_count = 0;
+// Fixed timestep, real time is banked here and spent in whole ticks
+static Uint64 last_time_ns = 0;
+static Uint64 tick_accumulator_ns = 0;
+
+// Key presses waiting for the next tick, see GAME_ACTION_*
+static uint32_t pending_actions = 0;
+// --record writes every tick's input, --replay plays a recording back
+static Replay* recording = NULL;
+static Replay* playback = NULL;
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv){
+    // Usage: game [--seed N] [--record file] [--replay file] [--trace file]
+    // A seed, a recording or a replay make the run reproducible
+    uint64_t seed = (uint64_t)time(NULL);
+    bool deterministic = false;
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(argv[i + 1], NULL, 10);
+            deterministic = true;
+        } else if (strcmp(argv[i], "--record") == 0) {
+            record_path = argv[i + 1];
+            deterministic = true;
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            replay_path = argv[i + 1];
+            deterministic = true;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            // Runs until the game closes
+            trace_start(argv[i + 1]);
+        } else {
+            printf("Warning: Unknown option %s\n", argv[i]);
+        }
+    }
+
+    trace_name_thread("main");
     printf("[SDL] Initializing SDL");
     SDL_SetAppMetadata("Example Renderer Points", "1.0", "com.example.renderer-points");
 
@@ -50,41 +82,46 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv){
         return SDL_APP_FAILURE;
     }
     renderer = SDL_CreateRenderer(window, NULL);
-
-    text_init();
-
     if (!renderer) {
         SDL_Log("Error creating renderer: %s", SDL_GetError());
         return SDL_APP_FAILURE;
     }
     printf("[SDL] Created window and renderer objects.\n");
 
+    text_init(renderer);
+    render_batch = render_batch_create(renderer);
+    if (!render_batch) {
+        SDL_Log("Couldn't allocate the render batch");
+        return SDL_APP_FAILURE;
+    }
+    // Vsync paces the frames when available, otherwise SDL_AppIterate sleeps
+    vsync_enabled = SDL_SetRenderVSync(renderer, 1);
+
     printf("[GAME] Initializing game objects.\n");
 
-    map_load_from_file(&current_level_map, "level.txt");
-    player_create(&player, &current_level_map);
+    // A level converted with tools/level_convert takes precedence over the text one
+    const char* level_path = map_file_is_binary("level.bin") ? "level.bin" : "level.txt";
+    // A replay brings its own level and seed
+    if (replay_path) {
+        playback = replay_play_open(replay_path);
+        if (!playback) return SDL_APP_FAILURE;
+        level_path = replay_level_path(playback);
+        seed = replay_seed(playback);
+        printf("[GAME] Replaying %s\n", replay_path);
+    }
+    printf("[GAME] Seed %llu\n", (unsigned long long)seed);
+    if (!game_load(level_path, renderer, seed, deterministic)) {
+        SDL_Log("Couldn't load level %s", level_path);
+        return SDL_APP_FAILURE;
+    }
+    if (record_path) {
+        recording = replay_record_open(record_path, level_path, seed);
+        if (recording) printf("[GAME] Recording to %s\n", record_path);
+    }
 
     SDL_SetRenderLogicalPresentation(renderer, 320, 180, SDL_LOGICAL_PRESENTATION_LETTERBOX);
 
-    active_enemy_count = current_level_map.enemy_count;
-    for (int i = 0 ; i < active_enemy_count; ++i){
-        if (current_level_map.enemies[i].has_spawned) {
-            printf("Spawning enemy: %s\n", current_level_map.enemies[i].id);
-            enemy_create(&enemies[i], &current_level_map.enemies[i], &current_level_map);
-        } else {
-            printf("Warning: Enemy '%s' was defined but not placed on the map.\n", current_level_map.enemies[i].id);
-        }
-    }
-
-    active_npc_count = current_level_map.npc_count;
-    for (int i = 0; i < active_npc_count; ++i) {
-        if (current_level_map.npcs[i].has_spawned) {
-            printf("Spawning NPC: %s\n", current_level_map.npcs[i].id);
-            npc_create(&npcs[i], &current_level_map.npcs[i]);
-        } else {
-             printf("Warning: NPC '%s' was defined but not placed on the map.\n", current_level_map.npcs[i].id);
-        }
-    }
+    last_time_ns = SDL_GetTicksNS();
 
     return SDL_APP_CONTINUE;
 }
@@ -95,73 +132,149 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
     }
 
     if (event->type == SDL_EVENT_KEY_DOWN) {
+        // Game input goes through the tick, a replay supplies its own
         if (event->key.key == SDLK_E) {
-            if (dialogue_is_active()) {
-                dialogue_advance();
-            } else {
-                Vector2f player_center = { player.rect.x + player.rect.w / 2.0f, player.rect.y + player.rect.h / 2.0f };
-                for (int i = 0; i < active_npc_count; ++i) {
-                    Vector2f npc_center = { npcs[i].rect.x + npcs[i].rect.w / 2.0f, npcs[i].rect.y + npcs[i].rect.h / 2.0f };
-                    float distance = vector_magnitude(vector_subtract(player_center, npc_center));
-                    if (distance < 50.0f && map_has_line_of_sight(&current_level_map, player_center, npc_center)) {
-                        dialogue_start_conversation(npcs[i].dialogue_lines, npcs[i].dialogue_line_count);
-                        break;
-                    }
-                }
-            }
+            if (!playback) pending_actions |= GAME_ACTION_INTERACT;
         } 
         // Handle pausing separately
         else if (event->key.key == SDLK_ESCAPE) {
-            if (current_game_state != GAME_STATE_PAUSE){
-                current_game_state = GAME_STATE_PAUSE;
-            } else if (current_game_state == GAME_STATE_PAUSE){
-                current_game_state = GAME_STATE_PLAYING;
+            if (!playback) pending_actions |= GAME_ACTION_PAUSE;
+        }
+        else if (event->key.key == SDLK_F3) {
+            show_render_stats = !show_render_stats;
+        }
+        else if (event->key.key == SDLK_F4) {
+            show_profiler = !show_profiler;
+        }
+        // F5 starts a trace, the next F5 writes it
+        else if (event->key.key == SDLK_F5) {
+            if (trace_is_running()) {
+                trace_stop();
+            } else {
+                trace_start("trace.json");
             }
         }
     }
     return SDL_APP_CONTINUE;
 }
 
+// Runs one tick with the live input, or the recorded one while a replay lasts
+static void run_tick(const bool* keyboard_state) {
+    static bool replay_keyboard[SDL_SCANCODE_COUNT];
+    uint32_t actions = pending_actions;
+    pending_actions = 0;
+
+    if (playback) {
+        if (replay_play_tick(playback, replay_keyboard, &actions)) {
+            keyboard_state = replay_keyboard;
+        } else {
+            printf("[GAME] Replay finished after %ld ticks, state hash %016llx\n",
+                   replay_tick_count(playback), (unsigned long long)game_state_hash());
+            replay_close(playback);
+            playback = NULL;
+        }
+    }
+    if (recording) {
+        replay_record_tick(recording, keyboard_state, actions);
+    }
+    game_tick(keyboard_state, actions);
+}
+
+#if PROFILING
+#define OVERLAY_X 150
+#define OVERLAY_WIDTH 168
+#define OVERLAY_LINE 8
+#define GRAPH_HEIGHT 30
+#define GRAPH_MAX_MS 33.3f // Top of the frame time graph, two 60 Hz frames
+
+// F4 overlay: average and p99 per zone over the profiler history, the enemy
+// updates run and deferred on the last tick, then the time of the recent frames as a graph with a line at one 60 Hz frame
+static void render_profiler_overlay() {
+    const int zone_lines = PROFILE_ZONE_COUNT + 2;
+    SDL_FRect background = { OVERLAY_X, 2, OVERLAY_WIDTH, zone_lines * OVERLAY_LINE + GRAPH_HEIGHT + 6 };
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+    SDL_RenderFillRect(renderer, &background);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    const SDL_Color header_color = { 255, 255, 0, 255 };
+    const SDL_Color zone_color = { 255, 255, 255, 255 };
+    char line[64];
+    text_render(renderer, "ZONE          AVG   P99", OVERLAY_X + 2, 3, header_color);
+    for (int zone = 0; zone < PROFILE_ZONE_COUNT; zone++) {
+        ProfileStats stats;
+        profiler_get_stats((ProfileZone)zone, &stats);
+        snprintf(line, sizeof(line), "%-11s %5.2f %5.2f", profiler_zone_name((ProfileZone)zone), stats.average_ms, stats.p99_ms);
+        text_render(renderer, line, OVERLAY_X + 2, 3 + (zone + 1) * OVERLAY_LINE, zone_color);
+    }
+    // Enemy updates on the last tick, see ENEMY_LOD_NEAR
+    snprintf(line, sizeof(line), "AI %5d run %5d def", enemies.thinking, enemies.deferred);
+    text_render(renderer, line, OVERLAY_X + 2, 3 + (PROFILE_ZONE_COUNT + 1) * OVERLAY_LINE, zone_color);
+
+    float frame_ms[OVERLAY_WIDTH - 4];
+    int count = profiler_frame_history(frame_ms, OVERLAY_WIDTH - 4);
+    const float graph_bottom = background.y + background.h - 3;
+    SDL_FPoint points[OVERLAY_WIDTH - 4];
+    for (int i = 0; i < count; i++) {
+        float height = frame_ms[i] / GRAPH_MAX_MS;
+        if (height > 1.0f) height = 1.0f;
+        points[i] = (SDL_FPoint){ OVERLAY_X + 2 + i, graph_bottom - height * GRAPH_HEIGHT };
+    }
+    const float budget_y = graph_bottom - (1000.0f / TICK_RATE) / GRAPH_MAX_MS * GRAPH_HEIGHT;
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    SDL_RenderLine(renderer, OVERLAY_X + 2, budget_y, OVERLAY_X + OVERLAY_WIDTH - 2, budget_y);
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    if (count > 1) SDL_RenderLines(renderer, points, count);
+}
+#endif
+
 SDL_AppResult SDL_AppIterate(void* appstate) {
-    const Uint64 frame_start_time = SDL_GetTicks();
+    PROFILE_BEGIN(PROFILE_ZONE_FRAME);
     const bool* keyboard_state = SDL_GetKeyboardState(NULL);
 
-    if (dialogue_is_active()) {
-        current_game_state = GAME_STATE_DIALOGUE;
-    } else if (current_game_state == GAME_STATE_DIALOGUE) {
-        // This check prevents us from getting stuck in the dialogue state
-        // after a conversation ends.
-        current_game_state = GAME_STATE_PLAYING;
-    }
-
-    switch (current_game_state) {
-        case GAME_STATE_PLAYING:
-            player_update(&player, keyboard_state, &current_level_map);
-            for (int i = 0; i < active_enemy_count; ++i){
-                enemy_update(&enemies[i], &player, &current_level_map);
-            }
-            break;
-        case GAME_STATE_DIALOGUE:
-            dialogue_update();
-            break;
-        case GAME_STATE_PAUSE:
-            break;
+    // Runs as many ticks as the time since the last frame pays for, a slow
+    // frame is followed by more ticks and a fast one by none
+    const Uint64 now_ns = SDL_GetTicksNS();
+    tick_accumulator_ns += now_ns - last_time_ns;
+    last_time_ns = now_ns;
+    if (tick_accumulator_ns > MAX_TICKS_PER_FRAME * TICK_NS) {
+        tick_accumulator_ns = MAX_TICKS_PER_FRAME * TICK_NS;
+    }
+    while (tick_accumulator_ns >= TICK_NS) {
+        run_tick(keyboard_state);
+        tick_accumulator_ns -= TICK_NS;
     }
 
-    camera_update(&camera, &player, &current_level_map, 2.5);
+    // The leftover time places this frame between the last two ticks
+    const float alpha = (float)tick_accumulator_ns / (float)TICK_NS;
+    const Camera view = render_lerp_rect(&previous_camera, &camera, alpha);
 
     // --- Rendering
+    TRACE_BEGIN("render");
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(renderer);
 
     // Render the game world
-    map_render(&current_level_map, renderer, &camera);
-    player_render(&player, renderer, &camera);
-    for (int i = 0; i < active_enemy_count; ++i) {
-        enemy_render(&enemies[i], renderer, &camera);
-    }
+    // Entities are culled against the camera and queued, then sent in one
+    // call per colour on top of the map
+    render_batch_begin(render_batch, &view);
+    PROFILE_BEGIN(PROFILE_ZONE_MAP_RENDER);
+    render_batch_count_draws(render_batch, map_render(&current_level_map, renderer, &view));
+    PROFILE_END(PROFILE_ZONE_MAP_RENDER);
+    PROFILE_BEGIN(PROFILE_ZONE_ENTITY_RENDER);
+    player_render(&player, render_batch, &view, alpha);
+    enemy_render_visible(&enemies, render_batch, &view, alpha);
     for (int i = 0; i < active_npc_count; ++i) {
-        npc_render(&npcs[i], renderer, &camera);
+        npc_render(&npcs[i], render_batch, &view);
+    }
+    render_batch_flush(render_batch);
+    PROFILE_END(PROFILE_ZONE_ENTITY_RENDER);
+
+    // F3 shows the world layer draw calls of the previous frame
+    if (show_render_stats) {
+        char stats[64];
+        snprintf(stats, sizeof(stats), "DRAW CALLS %d", render_batch_last_frame_draw_calls(render_batch));
+        text_render(renderer, stats, 2, 2, (SDL_Color){ 255, 255, 0, 255 });
     }
 
     if (dialogue_is_active()) {
@@ -201,23 +314,48 @@ SDL_AppResult SDL_AppIterate(void* appstate) {
         text_render(renderer, "PAUSED", (320 / 2) - ((8 * 6) / 2), (180 / 2) - (8 / 2), white);
     }
 
+#if PROFILING
+    if (show_profiler) {
+        render_profiler_overlay();
+    }
+#endif
+
+    TRACE_END("render");
+
     // Render everything
+    PROFILE_BEGIN(PROFILE_ZONE_PRESENT);
+    TRACE_BEGIN("present");
     SDL_RenderPresent(renderer);
+    TRACE_END("present");
+    PROFILE_END(PROFILE_ZONE_PRESENT);
+    PROFILE_END(PROFILE_ZONE_FRAME);
+    profiler_frame_end();
 
-    const Uint64 frame_time = SDL_GetTicks() - frame_start_time;
-    if (frame_time < FRAME_DELAY) {
-        SDL_Delay(FRAME_DELAY - frame_time);
+    // Without vsync nothing else paces the loop, sleep until the next tick is due
+    if (!vsync_enabled) {
+        const Uint64 elapsed_ns = SDL_GetTicksNS() - last_time_ns;
+        const Uint64 until_tick_ns = TICK_NS - tick_accumulator_ns;
+        if (elapsed_ns < until_tick_ns) {
+            SDL_DelayNS(until_tick_ns - elapsed_ns);
+        }
     }
 
     return SDL_APP_CONTINUE;
 }
 
 void SDL_AppQuit(void* appstate, SDL_AppResult result) {
-    // --- Memory Cleanup ---
-    // Call the destroy function for each NPC to free the dialogue memory.
-    for (int i = 0; i < active_npc_count; ++i) {
-        npc_destroy(&npcs[i]);
+    trace_stop();
+    if (recording) {
+        printf("[GAME] Recorded %ld ticks, state hash %016llx\n",
+               replay_tick_count(recording), (unsigned long long)game_state_hash());
     }
+    replay_close(recording);
+    recording = NULL;
+    replay_close(playback);
+    playback = NULL;
+    game_unload();
+    render_batch_destroy(render_batch);
+    render_batch = NULL;
     text_quit();
 }
 
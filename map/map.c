@@ -1,154 +1,269 @@
 // stalker-c/map/map.c
 
 #include "map.h"
+#include "map_binary.h"
+#include "map_cache.h"
+#include "../helper/profiler.h"
+#include "../helper/trace.h"
 #include <SDL3/SDL_rect.h>
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
 #include <stdlib.h>
 
 
-static NPCData* find_npc_data_by_id(Map* map, const char* id) {
-    for (int i = 0; i < map->npc_count; ++i) {
-        if (strcmp(map->npcs[i].id, id) == 0) {
-            return &map->npcs[i];
+/// The whole file is read with one call and walked line by line in place,
+/// rows are never copied and there is no limit on their length
+typedef struct {
+    const char* cursor;
+    const char* end;
+} LineReader;
+
+static bool next_line(LineReader* reader, const char** line, int* length) {
+    if (reader->cursor >= reader->end) return false;
+
+    const char* start = reader->cursor;
+    const char* newline = (const char*)memchr(start, '\n', reader->end - start);
+    const char* stop = newline ? newline : reader->end;
+    reader->cursor = newline ? newline + 1 : reader->end;
+
+    if (stop > start && stop[-1] == '\r') stop--;
+    *line = start;
+    *length = (int)(stop - start);
+    return true;
+}
+
+static bool line_starts_with(const char* line, int length, const char* prefix) {
+    int prefix_length = (int)strlen(prefix);
+    return length >= prefix_length && memcmp(line, prefix, prefix_length) == 0;
+}
+
+// Definitions are short, they get copied out so sscanf sees a terminated string
+static void copy_line(char* dest, int capacity, const char* line, int length) {
+    if (length > capacity - 1) length = capacity - 1;
+    memcpy(dest, line, length);
+    dest[length] = '\0';
+}
+
+/// Grid markers are a letter and a single digit, so every id the grid can name
+/// resolves with a direct lookup instead of a strcmp over every definition
+typedef struct {
+    int enemies[10];
+    int npcs[10];
+} EntityIndex;
+
+static void entity_index_add(int table[10], char prefix, const char* id, int slot) {
+    if (id[0] == prefix && id[1] >= '0' && id[1] <= '9' && id[2] == '\0' && table[id[1] - '0'] < 0) {
+        table[id[1] - '0'] = slot;
+    }
+}
+
+static int entity_index_find(const int table[10], char prefix, const char* id) {
+    if (id[0] == prefix && id[1] >= '0' && id[1] <= '9' && id[2] == '\0') {
+        return table[id[1] - '0'];
+    }
+    return -1;
+}
+
+/// Reads one grid row. An E# or N# marker takes both characters and leaves the
+/// tile as floor, characters past the end of a short row are floor too
+/// Walls are written in a straight pass over the row, the markers are rare and
+/// fixed up after, then the row is packed into the wall bitset
+static void parse_map_row(Map* map, const EntityIndex* index, const char* line, int length, int map_y) {
+    const int count = length < map->width ? length : map->width;
+    uint8_t* tiles = &map->tiles[map_y * map->width];
+
+    for (int x = 0; x < count; x++) {
+        tiles[x] = line[x] == '1' ? TILE_WALL : TILE_FLOOR;
+    }
+
+    for (int x = 0; x < count; x++) {
+        char current_char = line[x];
+        if (current_char < 'A') continue;
+
+        char peek_char = x + 1 < length ? line[x + 1] : '\0';
+        if (current_char == 'P') {
+            map->playerSpawn.x = x;
+            map->playerSpawn.y = map_y;
+        } else if ((current_char == 'E' || current_char == 'N') && peek_char >= '0' && peek_char <= '9') {
+            if (current_char == 'E') {
+                // The same marker can be placed any number of times
+                int slot = index->enemies[peek_char - '0'];
+                if (slot >= 0 && map_add_enemy_spawn(map, slot, x, map_y)) {
+                    map->enemies[slot].spawn_count++;
+                }
+            } else {
+                int slot = index->npcs[peek_char - '0'];
+                if (slot >= 0) {
+                    map->npcs[slot].spawn_pos.x = x;
+                    map->npcs[slot].spawn_pos.y = map_y;
+                    map->npcs[slot].has_spawned = true;
+                }
+            }
+            if (x + 1 < count) tiles[x + 1] = TILE_FLOOR;
+            x++;
         }
     }
-    return NULL; // Return NULL if not found
+
+    // The grid starts all floor, so only walls have to be set
+    const int row_start = map_y * map->width;
+    for (int x = 0; x < count; x++) {
+        int bit = row_start + x;
+        map->wall_bits[bit >> 6] |= (uint64_t)(tiles[x] == TILE_WALL) << (bit & 63);
+    }
 }
 
 /// This is the main map functiom it works as a "parser" for the map file
 void map_load_from_file(Map* map, const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (file == NULL) {
+    map->enemies = NULL;
+    map->enemy_count = 0;
+    map->enemy_capacity = 0;
+    map->enemy_spawns = NULL;
+    map->enemy_spawn_count = 0;
+    map->enemy_spawn_capacity = 0;
+    map->npcs = NULL;
+    map->npc_count = 0;
+    map->npc_capacity = 0;
+    map->cost_config.floor_cost = MAP_DEFAULT_FLOOR_COST;
+    map->cost_config.wall_penalty = MAP_DEFAULT_WALL_PENALTY;
+    map->tiles = NULL;
+    map->wall_bits = NULL;
+    map->cost_field = NULL;
+    map->file_data = NULL;
+    map->file_size = 0;
+    map->hierarchy = NULL;
+    map->pathfinding = NULL;
+    map->player_flow = NULL;
+    map->path_jobs = NULL;
+    map->player_visibility = NULL;
+    map->render_cache = NULL;
+
+    // Levels converted with tools/level_convert are mapped as they are
+    if (map_file_is_binary(filename)) {
+        map_load_binary(map, filename);
+        return;
+    }
+
+    size_t file_size = 0;
+    char* contents = (char*)SDL_LoadFile(filename, &file_size);
+    if (contents == NULL) {
         printf("Error: Could not open map file %s\n", filename);
         return;
     }
 
+    LineReader reader = { contents, contents + file_size };
+    const char* line;
+    int length;
+    char scratch[512];
+
     // This assumes the first line of the map file is "width,height"
-    if (fscanf(file, "%d,%d\n", &map->width, &map->height) != 2) {
+    if (!next_line(&reader, &line, &length)) length = 0;
+    copy_line(scratch, sizeof(scratch), line, length);
+    if (length == 0 || sscanf(scratch, "%d,%d", &map->width, &map->height) != 2) {
         printf("Error: Could not read map dimensions from %s\n", filename);
-        fclose(file);
+        SDL_free(contents);
         return;
     }
 
-    // Dynamically allocate memory for the tiles
-    map->tiles = (int**)malloc(map->height * sizeof(int*));
-    for (int i = 0; i < map->height; i++) {
-        map->tiles[i] = (int*)malloc(map->width * sizeof(int));
+    // One contiguous grid, rows the file does not fill stay floor
+    if (!map_alloc_tiles(map, map->width, map->height)) {
+        printf("Error: Could not allocate a %dx%d map\n", map->width, map->height);
+        SDL_free(contents);
+        return;
     }
 
-    srand(time(NULL));
-
-    map->enemy_count = 0;
+    EntityIndex index;
+    memset(&index, -1, sizeof(index));
 
     Parser p;
     p.state = STATE_UNKNOWN;
-    p.line_number = 0;
-
-    char line_buffer[256];
+    p.line_number = 1;
     int map_y = 0;
 
-    while (fgets(line_buffer, sizeof(line_buffer), file)){
+    while (next_line(&reader, &line, &length)) {
         p.line_number++;
 
-        if (line_buffer[0] == '\n' || line_buffer[0] == '#' || line_buffer[0] == '\r') {
-        continue;
+        if (length == 0 || line[0] == '#') {
+            continue;
         }
 
         // Check for section
-        if (strncmp(line_buffer, "enemy:", 6) == 0) {
+        if (line_starts_with(line, length, "enemy:")) {
             p.state = STATE_PARSING_ENEMY;
             continue;
-        } else if (strncmp(line_buffer, "npc:", 4) == 0) {
+        } else if (line_starts_with(line, length, "npc:")) {
             p.state = STATE_PARSING_NPC;
             continue;
-        } else if (strncmp(line_buffer, "map:", 4) == 0) {
+        } else if (line_starts_with(line, length, "map:")) {
             p.state = STATE_PARSING_MAP;
             continue;
-        } 
+        } else if (line_starts_with(line, length, "cost:")) {
+            p.state = STATE_PARSING_COST;
+            continue;
+        }
 
         switch (p.state){
             case STATE_PARSING_ENEMY:
-                if (map->enemy_count < MAX_ENEMIES){
-                    sscanf(line_buffer, "%[^=]=(%f,%f,%f,%f,%f,%f,%f,%f)",
-                            map->enemies[map->enemy_count].id,
-                            &map->enemies[map->enemy_count].size.x,
-                            &map->enemies[map->enemy_count].size.y,
-                            &map->enemies[map->enemy_count].sight_range,
-                            &map->enemies[map->enemy_count].perception_radius,
-                            &map->enemies[map->enemy_count].attack_range,
-                            &map->enemies[map->enemy_count].walking_speed,
-                            &map->enemies[map->enemy_count].stalking_speed,
-                            &map->enemies[map->enemy_count].attacking_speed
+            {
+                EnemyData* enemy = map_add_enemy(map);
+                if (enemy) {
+                    copy_line(scratch, sizeof(scratch), line, length);
+                    sscanf(scratch, "%3[^=]=(%f,%f,%f,%f,%f,%f,%f,%f)",
+                            enemy->id,
+                            &enemy->size.x,
+                            &enemy->size.y,
+                            &enemy->sight_range,
+                            &enemy->perception_radius,
+                            &enemy->attack_range,
+                            &enemy->walking_speed,
+                            &enemy->stalking_speed,
+                            &enemy->attacking_speed
                             );
-                    printf("Created enemy '%s' (%f,%f)\n",
-                            map->enemies[map->enemy_count].id,
-                            map->enemies[map->enemy_count].size.x,
-                            map->enemies[map->enemy_count].size.y);
-                    map->enemy_count++;
+                    printf("Created enemy '%s' (%f,%f)\n", enemy->id, enemy->size.x, enemy->size.y);
+                    entity_index_add(index.enemies, 'E', enemy->id, map->enemy_count - 1);
                 }
                 break;
+            }
 
             case STATE_PARSING_MAP:
+                // Rows are read straight out of the file buffer
                 if (map_y < map->height) {
-                    for (int x = 0; x < map->width; x++) {
-                        char current_char = line_buffer[x];
-                        char peek_char = line_buffer[x+1];
-
-                        map->tiles[map_y][x] = 0;
-
-                        if (current_char == '1') {
-                            map->tiles[map_y][x] = 1;
-                        } else if (current_char == 'P') {
-                            map->playerSpawn.x = x;
-                            map->playerSpawn.y = map_y;
-                        } else if (current_char == 'E' && peek_char >= '0' && peek_char <= '9') {
-                            char enemy_id[4] = {'E', peek_char, '\0'};
-                            for (int i = 0; i < map->enemy_count; ++i){
-                                if (strcmp(map->enemies[i].id, enemy_id) == 0) {
-                                    map->enemies[i].spawn_pos.x = x;
-                                    map->enemies[i].spawn_pos.y = map_y;
-                                    map->enemies[i].has_spawned = true;
-                                    break;
-                                }
-                            }
-                        } else if (current_char == 'N' && peek_char >= '0' && peek_char <= '9') {
-                            char npc_id[4] = { 'N', peek_char, '\0' };
-                            for (int i = 0; i < map->npc_count; ++i) {
-                                if (strcmp(map->npcs[i].id, npc_id) == 0) {
-                                    map->npcs[i].spawn_pos.x = x;
-                                    map->npcs[i].spawn_pos.y = map_y;
-                                    map->npcs[i].has_spawned = true;
-                                    break;
-                                }
-                            }
-                        }
-                    }
+                    parse_map_row(map, &index, line, length, map_y);
                     map_y++;
                 }
                 break;
+
             case STATE_PARSING_NPC:
-                // --- THIS IS THE NEW LOGIC ---
-                if (strncmp(line_buffer, "define:", 7) == 0) {
-                    if (map->npc_count < MAX_NPCS) {
-                        NPCData* current_npc = &map->npcs[map->npc_count];
-                        current_npc->dialogue_line_count = 0; // IMPORTANT: Initialize count
-                        sscanf(line_buffer, "define:%[^,],%f,%f",
+                copy_line(scratch, sizeof(scratch), line, length);
+                if (strncmp(scratch, "define:", 7) == 0) {
+                    NPCData* current_npc = map_add_npc(map);
+                    if (current_npc) {
+                        sscanf(scratch, "define:%3[^,],%f,%f",
                                current_npc->id, &current_npc->size.x, &current_npc->size.y);
-                        map->npc_count++;
+                        entity_index_add(index.npcs, 'N', current_npc->id, map->npc_count - 1);
                     }
-                } else if (strncmp(line_buffer, "dialogue:", 9) == 0) {
-                    char temp_id[4];
+                } else if (strncmp(scratch, "dialogue:", 9) == 0) {
+                    char temp_id[4] = { 0 };
                     char temp_dialogue[MAX_DIALOGUE_LINE_LENGTH];
-                    
+
                     // The format string "%[^,],\"%[^\"]\"" is specific:
                     // %[^,]    -> Read everything until a comma (the ID)
                     // ,\"       -> Match the comma and the opening quote
                     // %[^\"]\" -> Read everything until the closing quote
-                    sscanf(line_buffer, "dialogue:%[^,],\"%[^\"]\"", temp_id, temp_dialogue);
-                    
-                    NPCData* target_npc = find_npc_data_by_id(map, temp_id);
+                    // The widths keep long lines from overflowing the buffers
+                    if (sscanf(scratch, "dialogue:%3[^,],\"%127[^\"]\"", temp_id, temp_dialogue) != 2) break;
+
+                    int slot = entity_index_find(index.npcs, 'N', temp_id);
+                    if (slot < 0) {
+                        // Ids the grid cannot name are still allowed here
+                        for (int i = 0; i < map->npc_count; ++i) {
+                            if (strcmp(map->npcs[i].id, temp_id) == 0) {
+                                slot = i;
+                                break;
+                            }
+                        }
+                    }
+                    NPCData* target_npc = slot >= 0 ? &map->npcs[slot] : NULL;
                     if (target_npc && target_npc->dialogue_line_count < MAX_DIALOGUE_LINES) {
                         strcpy(target_npc->dialogue_lines[target_npc->dialogue_line_count], temp_dialogue);
                         target_npc->dialogue_line_count++;
@@ -156,16 +271,97 @@ void map_load_from_file(Map* map, const char* filename) {
                 }
                 break;
 
+            case STATE_PARSING_COST:
+                // Lines look like "wall_penalty=15"
+                copy_line(scratch, sizeof(scratch), line, length);
+                if (strncmp(scratch, "floor=", 6) == 0) {
+                    sscanf(scratch, "floor=%d", &map->cost_config.floor_cost);
+                } else if (strncmp(scratch, "wall_penalty=", 13) == 0) {
+                    sscanf(scratch, "wall_penalty=%d", &map->cost_config.wall_penalty);
+                }
+                break;
+
             case STATE_UNKNOWN:
                 break;
         }
     }
+
+    SDL_free(contents);
+    // Navigation can't run on a level without costs, it fails to load
+    if (!map_build_cost_field(map)) {
+        map_destroy(map);
+    }
+}
+
+// True if ptr lives inside the binary level mapping and must not be freed
+static bool map_is_file_backed(const Map* map, const void* ptr) {
+    const uint8_t* base = (const uint8_t*)map->file_data;
+    const uint8_t* p = (const uint8_t*)ptr;
+    return base && p >= base && p < base + map->file_size;
+}
+
+/// Bakes the wall proximity penalty into one byte per tile so the pathfinding
+/// inner loop reads a single value instead of rescanning the 8 neighbours
+bool map_build_cost_field(Map* map) {
+    if (!map_is_file_backed(map, map->cost_field)) free(map->cost_field);
+    // Walls per column over the rows y-1..y+1, so each tile sums 3 columns
+    // instead of probing its 8 neighbours one by one
+    int* column = (int*)malloc((size_t)map->width * sizeof(int));
+    map->cost_field = (uint8_t*)malloc((size_t)map->width * map->height);
+    if (!column || !map->cost_field) {
+        printf("Error: Could not allocate the cost field\n");
+        free(column);
+        free(map->cost_field);
+        map->cost_field = NULL;
+        return false;
+    }
+
+    // Cost only depends on how many of the 8 neighbours are walls
+    uint8_t cost_by_walls[9];
+    for (int walls = 0; walls <= 8; walls++) {
+        // Clamp to the byte range, 0 is reserved for walls
+        int cost = map->cost_config.floor_cost + walls * map->cost_config.wall_penalty;
+        if (cost < 1) cost = 1;
+        if (cost > 255) cost = 255;
+        cost_by_walls[walls] = (uint8_t)cost;
+    }
+
+    for (int y = 0; y < map->height; y++) {
+        const uint8_t* above = y > 0 ? &map->tiles[(y - 1) * map->width] : NULL;
+        const uint8_t* row = &map->tiles[y * map->width];
+        const uint8_t* below = y + 1 < map->height ? &map->tiles[(y + 1) * map->width] : NULL;
+        for (int x = 0; x < map->width; x++) {
+            column[x] = (row[x] == TILE_WALL)
+                + (above && above[x] == TILE_WALL)
+                + (below && below[x] == TILE_WALL);
+        }
+
+        uint8_t* costs = &map->cost_field[y * map->width];
+        for (int x = 0; x < map->width; x++) {
+            if (row[x] == TILE_WALL) {
+                costs[x] = 0;
+                continue;
+            }
+            int walls = column[x];
+            if (x > 0) walls += column[x - 1];
+            if (x + 1 < map->width) walls += column[x + 1];
+            costs[x] = cost_by_walls[walls];
+        }
+    }
+    free(column);
+    return true;
 }
 
-void map_render(Map* map, SDL_Renderer* renderer, const SDL_FRect* camera) {
+int map_render(Map* map, SDL_Renderer* renderer, const SDL_FRect* camera) {
     const float map_pixel_width = map->width * TILE_SIZE;
     const float map_pixel_height = map->height * TILE_SIZE;
 
+    // Walls are prerendered in chunks when the renderer allows it
+    if (map->render_cache) {
+        return map_cache_render(map->render_cache, map, camera);
+    }
+    int draw_calls = 0;
+
     SDL_SetRenderDrawColor(renderer, 100, 100, 100, SDL_ALPHA_OPAQUE);
 
     // Optimization: determine which tiles are visible to the camera
@@ -183,7 +379,7 @@ void map_render(Map* map, SDL_Renderer* renderer, const SDL_FRect* camera) {
     // Loop only through the visible tiles
     for (int y = start_row; y < end_row; y++) {
         for (int x = start_col; x < end_col; x++) {
-            if (map->tiles[y][x] == 1) {
+            if (map_is_wall(map, x, y)) {
                 // Calculate the tile's absolute world position
                 float tile_world_x =  (float)x * TILE_SIZE;
                 float tile_world_y = (float)y * TILE_SIZE;
@@ -196,49 +392,129 @@ void map_render(Map* map, SDL_Renderer* renderer, const SDL_FRect* camera) {
                     .h = TILE_SIZE
                 };
                 SDL_RenderRect(renderer, &wall_rect);
+                draw_calls++;
             }
         }
     }
+    return draw_calls;
 }
-/// This is pretty self explanatory, returns a boolean that
-/// indicates start->end line of sight exists
-bool map_has_line_of_sight(const Map *map, Vector2f start, Vector2f end){
-    const float map_pixel_width = map->width * TILE_SIZE;
-    const float map_pixel_height = map->height * TILE_SIZE;
-
-    Vector2f dir = vector_subtract(end, start);
-    float line_length = vector_magnitude(dir);
-    dir = vector_normalize(dir);
+// Positions are converted to fixed point before walking the grid, so every
+// comparison below is exact integer math. 8 bits is well below a pixel
+#define LOS_SUBPIXEL_BITS 8
+#define LOS_TILE ((int64_t)TILE_SIZE << LOS_SUBPIXEL_BITS)
 
-    for (float i = 0; i < line_length; i += TILE_SIZE / 2.0f) {
-        float check_x = start.x + dir.x * i;
-        float check_y = start.y + dir.y * i;
+static int64_t los_fixed(float v) {
+    return (int64_t)floorf(v * (float)(1 << LOS_SUBPIXEL_BITS));
+}
 
-        int grid_x = check_x / TILE_SIZE;
-        int grid_y = check_y / TILE_SIZE;
+// Floor division, the usual "/" rounds negative coordinates the wrong way
+static int los_tile(int64_t v) {
+    return (int)(v >= 0 ? v / LOS_TILE : -((-v + LOS_TILE - 1) / LOS_TILE));
+}
 
-        if (grid_x < 0 || grid_x >= map->width || grid_y < 0 || grid_y >= map->height) {
-            return false;
+/// Walks the segment from (x0, y0) to (x1, y1) (fixed point) tile by tile
+/// (Amanatides & Woo). At every step the ray leaves the current tile through
+/// whichever side it reaches first, found by cross multiplying the distances
+/// to the next vertical and horizontal borders, so no tile is ever skipped.
+/// When the ray goes exactly through a corner both side tiles are checked.
+/// A segment that ends on a corner only steps the axis still short of the end
+/// tile there, it never enters the tiles past its end
+static bool los_traverse(const Map* map, int64_t x0, int64_t y0, int64_t x1, int64_t y1) {
+    int tx = los_tile(x0);
+    int ty = los_tile(y0);
+    const int end_tx = los_tile(x1);
+    const int end_ty = los_tile(y1);
+    if (map_is_wall(map, tx, ty)) return false;
+
+    const int64_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    const int64_t dy = y1 > y0 ? y1 - y0 : y0 - y1;
+    const int step_x = x1 > x0 ? 1 : (x1 < x0 ? -1 : 0);
+    const int step_y = y1 > y0 ? 1 : (y1 < y0 ? -1 : 0);
+
+    // Distance along each axis to the next border, the border the ray crosses
+    // first is the one with the smallest distance / delta
+    int64_t dist_x = step_x > 0 ? (int64_t)(tx + 1) * LOS_TILE - x0 : x0 - (int64_t)tx * LOS_TILE;
+    int64_t dist_y = step_y > 0 ? (int64_t)(ty + 1) * LOS_TILE - y0 : y0 - (int64_t)ty * LOS_TILE;
+    if (step_x == 0) dist_x = LOS_TILE;
+    if (step_y == 0) dist_y = LOS_TILE;
+
+    // Each step moves exactly one tile closer on one axis (two on a corner)
+    int remaining = abs(end_tx - tx) + abs(end_ty - ty);
+    while (remaining > 0) {
+        int64_t cross_x = dist_x * dy;
+        int64_t cross_y = dist_y * dx;
+
+        if (cross_x < cross_y) {
+            tx += step_x;
+            dist_x += LOS_TILE;
+            remaining--;
+        } else if (cross_y < cross_x) {
+            ty += step_y;
+            dist_y += LOS_TILE;
+            remaining--;
+        } else if (tx != end_tx && ty != end_ty) {
+            // Through a corner, a wall on either side blocks the view
+            if (map_is_wall(map, tx + step_x, ty) || map_is_wall(map, tx, ty + step_y)) return false;
+            tx += step_x;
+            ty += step_y;
+            dist_x += LOS_TILE;
+            dist_y += LOS_TILE;
+            remaining -= 2;
+        } else if (tx != end_tx) {
+            // The segment ends on the corner, only one axis is left to reach
+            // the end tile and the tiles past the corner are never touched
+            tx += step_x;
+            dist_x += LOS_TILE;
+            remaining--;
+        } else {
+            ty += step_y;
+            dist_y += LOS_TILE;
+            remaining--;
         }
 
-        if (map->tiles[grid_y][grid_x] == 1) {
-            return false;
-        }
+        if (map_is_wall(map, tx, ty)) return false;
     }
     return true;
 }
 
+/// This is pretty self explanatory, returns a boolean that
+/// indicates start->end line of sight exists
+/// Every tile the segment touches is checked, leaving the map counts as blocked
+bool map_has_line_of_sight(const Map *map, Vector2f start, Vector2f end){
+    PROFILE_BEGIN(PROFILE_ZONE_LOS);
+    bool visible = los_traverse(map, los_fixed(start.x), los_fixed(start.y), los_fixed(end.x), los_fixed(end.y));
+    PROFILE_END(PROFILE_ZONE_LOS);
+    return visible;
+}
+
+/// The origin is converted and checked once for all targets, each ray is
+/// still walked on its own
+void map_has_line_of_sight_batch(const Map* map, Vector2f origin, const Vector2f* targets, int count, bool* out) {
+    PROFILE_BEGIN(PROFILE_ZONE_LOS);
+    TRACE_BEGIN_ARGS("los batch", "targets", count, NULL, 0);
+    const int64_t ox = los_fixed(origin.x);
+    const int64_t oy = los_fixed(origin.y);
+
+    // An origin inside a wall or off the map sees nothing
+    const bool blind = map_is_wall(map, los_tile(ox), los_tile(oy));
+    for (int i = 0; i < count; i++) {
+        out[i] = !blind && los_traverse(map, ox, oy, los_fixed(targets[i].x), los_fixed(targets[i].y));
+    }
+    TRACE_END("los batch");
+    PROFILE_END(PROFILE_ZONE_LOS);
+}
+
 /// Returns a random empty tile, useful for enemy patrolling
-Vector2f map_get_random_walkable_tile(const Map* map) {
+Vector2f map_get_random_walkable_tile(const Map* map, Rng* rng) {
     int x, y;
     int safety_counter = 0;
 
     // FIX: Use a do-while loop to ensure x and y are initialized before use.
     do {
-        x = rand() % map->width;
-        y = rand() % map->height;
+        x = rng_range(rng, map->width);
+        y = rng_range(rng, map->height);
         safety_counter++;
-    } while (map->tiles[y][x] == 1 && safety_counter < 1000);
+    } while (map_is_wall(map, x, y) && safety_counter < 1000);
 
     const float map_pixel_width = map->width * TILE_SIZE;
     const float map_pixel_height = map->height * TILE_SIZE;
@@ -249,12 +525,79 @@ Vector2f map_get_random_walkable_tile(const Map* map) {
     };
 }
 
-void map_destroy(Map* map) {
-    if (map->tiles) {
-        for (int i = 0; i < map->height; i++) {
-            free(map->tiles[i]);
-        }
+bool map_alloc_tiles(Map* map, int width, int height) {
+    size_t count = (size_t)width * height;
+    map->width = width;
+    map->height = height;
+    map->tiles = (uint8_t*)calloc(count, sizeof(uint8_t));
+    map->wall_bits = (uint64_t*)calloc((count + 63) / 64, sizeof(uint64_t));
+    if (!map->tiles || !map->wall_bits) {
         free(map->tiles);
+        free(map->wall_bits);
+        map->tiles = NULL;
+        map->wall_bits = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Doubles an entity array until it holds one more item
+static bool grow_array(void** items, int* capacity, int count, size_t item_size) {
+    if (count < *capacity) return true;
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 8;
+    void* grown = realloc(*items, (size_t)new_capacity * item_size);
+    if (!grown) {
+        printf("Error: Could not grow the level entity list to %d\n", new_capacity);
+        return false;
+    }
+    *items = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+EnemyData* map_add_enemy(Map* map) {
+    if (!grow_array((void**)&map->enemies, &map->enemy_capacity, map->enemy_count, sizeof(EnemyData))) return NULL;
+    EnemyData* enemy = &map->enemies[map->enemy_count++];
+    memset(enemy, 0, sizeof(*enemy));
+    return enemy;
+}
+
+EnemySpawn* map_add_enemy_spawn(Map* map, int data, int x, int y) {
+    if (!grow_array((void**)&map->enemy_spawns, &map->enemy_spawn_capacity, map->enemy_spawn_count, sizeof(EnemySpawn))) return NULL;
+    EnemySpawn* spawn = &map->enemy_spawns[map->enemy_spawn_count++];
+    spawn->data = data;
+    spawn->pos.x = x;
+    spawn->pos.y = y;
+    return spawn;
+}
+
+NPCData* map_add_npc(Map* map) {
+    if (!grow_array((void**)&map->npcs, &map->npc_capacity, map->npc_count, sizeof(NPCData))) return NULL;
+    NPCData* npc = &map->npcs[map->npc_count++];
+    memset(npc, 0, sizeof(*npc));
+    return npc;
+}
+
+void map_destroy(Map* map) {
+    free(map->enemies);
+    free(map->enemy_spawns);
+    free(map->npcs);
+    map->enemies = NULL;
+    map->enemy_spawns = NULL;
+    map->npcs = NULL;
+    map->enemy_count = map->enemy_capacity = 0;
+    map->enemy_spawn_count = map->enemy_spawn_capacity = 0;
+    map->npc_count = map->npc_capacity = 0;
+    if (!map_is_file_backed(map, map->tiles)) free(map->tiles);
+    if (!map_is_file_backed(map, map->wall_bits)) free(map->wall_bits);
+    if (!map_is_file_backed(map, map->cost_field)) free(map->cost_field);
+    map->tiles = NULL;
+    map->wall_bits = NULL;
+    map->cost_field = NULL;
+    if (map->file_data) {
+        map_release_file(map->file_data, map->file_size);
+        map->file_data = NULL;
+        map->file_size = 0;
     }
 }
 
@@ -6,13 +6,13 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_oldnames.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include "../defs/defs.h"
 #include "../helper/vector.h"
+#include "../helper/rng.h"
 
 #define TILE_SIZE        16
-#define MAX_ENEMIES      10
-#define MAX_NPCS         10
 
 #define MAX_DIALOGUE_LINES 10
 #define MAX_DIALOGUE_LINE_LENGTH 128
@@ -22,13 +22,15 @@ typedef enum {
     STATE_PARSING_ENEMY,
     STATE_PARSING_NPC,
     STATE_PARSING_MAP,
+    STATE_PARSING_COST,
 } ParserState;
 
+/// An enemy type from the "enemy:" section, the grid can place it any number
+/// of times, see EnemySpawn
 typedef struct {
     char id[4];
     Vector2f size;
-    Vector2 spawn_pos;
-    bool has_spawned;
+    int spawn_count; // Times the grid places it
 
     float sight_range;
     float perception_radius;
@@ -39,6 +41,11 @@ typedef struct {
     float attacking_speed;
 } EnemyData;
 
+typedef struct {
+    int data;     // Index into Map.enemies
+    Vector2 pos;  // Tile the marker is on
+} EnemySpawn;
+
 typedef struct NPCData {
     char id[4];
     Vector2f size;
@@ -48,15 +55,56 @@ typedef struct NPCData {
     int dialogue_line_count;
 } NPCData;
 
+/// Traversal cost tuning, can be overridden by the "cost:" section of the level
+/// Every open tile costs floor_cost, plus wall_penalty for each wall among its
+/// 8 neighbours, this is what makes enemies avoid hugging walls
+typedef struct {
+    int floor_cost;
+    int wall_penalty;
+} MapCostConfig;
+
+#define MAP_DEFAULT_FLOOR_COST   1
+#define MAP_DEFAULT_WALL_PENALTY 15
+
+/// What a tile is made of, stored as one byte per tile
+typedef enum {
+    TILE_FLOOR = 0,
+    TILE_WALL = 1,
+} TileType;
+
+// Navigation data built on top of the map, see helper/pathfinding.h
+struct PathfindingContext;
+struct PathHierarchy;
+struct FlowField;
+struct PathJobSystem;
+struct VisibilityField;
+struct MapRenderCache;
+
 typedef struct {
-    int **tiles;
+    uint8_t* tiles;      // width * height TileType values, row major
+    uint64_t* wall_bits; // Same grid packed to one bit per tile, 1 is a wall
     int width;
     int height;
     Vector2 playerSpawn;
-    EnemyData enemies[MAX_ENEMIES];
+    EnemyData* enemies;        // Definitions, every array here grows while the level is read
     int enemy_count;
-    NPCData npcs[MAX_NPCS];
+    int enemy_capacity;
+    EnemySpawn* enemy_spawns;  // One per E# marker in the grid
+    int enemy_spawn_count;
+    int enemy_spawn_capacity;
+    NPCData* npcs;             // NPCs are placed once each, the spawn is kept in NPCData
     int npc_count;
+    int npc_capacity;
+    MapCostConfig cost_config;
+    uint8_t* cost_field; // Per tile traversal cost, 0 means not walkable
+    void* file_data;     // Binary level mapping the grids point into, NULL for text levels
+    size_t file_size;
+    struct PathHierarchy* hierarchy;        // Abstract graph for long queries, see helper/hpa.h
+    struct PathfindingContext* pathfinding; // Search arena reused by every query
+    struct FlowField* player_flow;          // Shared field toward the player, see helper/flowfield.h
+    struct PathJobSystem* path_jobs;        // Worker threads for enemy searches, NULL runs them inline
+    struct VisibilityField* player_visibility; // Tiles that can see the player, see helper/visibility.h
+    struct MapRenderCache* render_cache;    // Prerendered wall chunks, see map/map_cache.h
 } Map;
 
 typedef struct {
@@ -66,10 +114,64 @@ typedef struct {
     char peek;
 } Parser;
 
+/// Tile accessors, every module reads the grid through these
+static inline bool map_in_bounds(const Map* map, int x, int y) {
+    return x >= 0 && x < map->width && y >= 0 && y < map->height;
+}
+
+static inline TileType map_get_tile(const Map* map, int x, int y) {
+    return (TileType)map->tiles[y * map->width + x];
+}
+
+// Anything outside the map counts as a wall
+static inline bool map_is_wall(const Map* map, int x, int y) {
+    if (!map_in_bounds(map, x, y)) return true;
+    int index = y * map->width + x;
+    return (map->wall_bits[index >> 6] >> (index & 63)) & 1;
+}
+
+// Defined in map_cache.c, a changed tile has to reach the prerendered chunks
+void map_cache_mark_dirty(struct MapRenderCache* cache, int tile_x, int tile_y);
+
+// Keeps the byte grid, the wall bitset and the render cache in sync. Only for
+// building a level, call map_build_cost_field once the tiles are set. The
+// hierarchy and the player's flow and visibility fields game_load bakes from
+// them are never rebuilt, and the path workers read them without locking,
+// so tiles can't change once game_load has run
+static inline void map_set_tile(Map* map, int x, int y, TileType type) {
+    SDL_assert(!map->hierarchy && !map->pathfinding && !map->path_jobs
+               && !map->player_flow && !map->player_visibility);
+    int index = y * map->width + x;
+    uint64_t mask = (uint64_t)1 << (index & 63);
+    map->tiles[index] = (uint8_t)type;
+    if (type == TILE_WALL) {
+        map->wall_bits[index >> 6] |= mask;
+    } else {
+        map->wall_bits[index >> 6] &= ~mask;
+    }
+    if (map->render_cache) map_cache_mark_dirty(map->render_cache, x, y);
+}
+
+// Allocates an all floor grid of the given size, tiles and wall_bits are freed by map_destroy
+bool map_alloc_tiles(Map* map, int width, int height);
+// Append to the entity arrays, growing them as needed. Return the new entry
+// or NULL when out of memory. map_destroy frees the arrays
+EnemyData* map_add_enemy(Map* map);
+EnemySpawn* map_add_enemy_spawn(Map* map, int data, int x, int y);
+NPCData* map_add_npc(Map* map);
+
 void map_load_from_file(Map* map, const char* filename);
-void map_render(Map* map, SDL_Renderer* renderer, const SDL_FRect *camera);
+// Returns the number of draw calls it made
+int map_render(Map* map, SDL_Renderer* renderer, const SDL_FRect *camera);
 bool map_has_line_of_sight(const Map *map, Vector2f start, Vector2f end);
-Vector2f map_get_random_walkable_tile(const Map* map);
+// Same test from one origin to count targets, out[i] is the result for targets[i].
+// Only the origin work is shared, every target still walks its own ray
+void map_has_line_of_sight_batch(const Map* map, Vector2f origin, const Vector2f* targets, int count, bool* out);
+Vector2f map_get_random_walkable_tile(const Map* map, Rng* rng);
+// Rebuilds cost_field from the tiles and cost_config, the loader calls it once
+// but it can be called again after tweaking cost_config. Returns false when
+// out of memory, cost_field is NULL then
+bool map_build_cost_field(Map* map);
 void map_destroy(Map* map);
 
 #endif // MAP_H
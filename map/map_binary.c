@@ -0,0 +1,303 @@
+// stalker-c/map/map_binary.c
+
+#include "map_binary.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define MAP_BIN_USE_MMAP 0
+#else
+#define MAP_BIN_USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The file keeps the in-memory dialogue layout, so they must agree
+_Static_assert(MAP_BIN_DIALOGUE_LINES == MAX_DIALOGUE_LINES, "dialogue line count changed, bump MAP_BIN_VERSION");
+_Static_assert(MAP_BIN_DIALOGUE_LENGTH == MAX_DIALOGUE_LINE_LENGTH, "dialogue line length changed, bump MAP_BIN_VERSION");
+
+static uint64_t align_up(uint64_t value) {
+    return (value + MAP_BIN_ALIGN - 1) & ~(uint64_t)(MAP_BIN_ALIGN - 1);
+}
+
+// Fills in every offset for a map of this shape, returns the file size
+static uint64_t layout_header(MapBinHeader* header) {
+    uint64_t tile_count = (uint64_t)header->width * header->height;
+    header->enemies_offset = align_up(sizeof(MapBinHeader));
+    header->enemy_spawns_offset = align_up(header->enemies_offset + header->enemy_count * sizeof(MapBinEnemy));
+    header->npcs_offset = align_up(header->enemy_spawns_offset + header->enemy_spawn_count * sizeof(MapBinEnemySpawn));
+    header->tiles_offset = align_up(header->npcs_offset + header->npc_count * sizeof(MapBinNpc));
+    header->walls_offset = align_up(header->tiles_offset + tile_count);
+    header->cost_offset = align_up(header->walls_offset + ((tile_count + 63) / 64) * sizeof(uint64_t));
+    return header->cost_offset + tile_count;
+}
+
+bool map_file_is_binary(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+    char magic[8];
+    bool is_binary = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+        && memcmp(magic, MAP_BIN_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return is_binary;
+}
+
+static bool validate_header(const MapBinHeader* header, uint64_t size, const char* filename) {
+    if (size < sizeof(MapBinHeader) || memcmp(header->magic, MAP_BIN_MAGIC, sizeof(header->magic)) != 0) {
+        printf("Error: %s is not a binary level\n", filename);
+        return false;
+    }
+    if (header->byte_order != MAP_BIN_BYTE_ORDER) {
+        printf("Error: %s was written on a machine with a different byte order\n", filename);
+        return false;
+    }
+    if (header->version != MAP_BIN_VERSION) {
+        printf("Error: %s is version %u, this build reads version %d\n", filename, header->version, MAP_BIN_VERSION);
+        return false;
+    }
+    if (header->width <= 0 || header->height <= 0 || header->enemy_count < 0
+            || header->enemy_spawn_count < 0 || header->npc_count < 0) {
+        printf("Error: %s has a corrupt header\n", filename);
+        return false;
+    }
+
+    // The offsets are derived from the counts, anything else is a corrupt file
+    MapBinHeader expected = *header;
+    uint64_t expected_size = layout_header(&expected);
+    if (memcmp(&expected, header, sizeof(expected)) != 0 || expected_size != header->file_size || size < expected_size) {
+        printf("Error: %s is truncated or corrupt\n", filename);
+        return false;
+    }
+    return true;
+}
+
+/// Reads the whole file into memory. With mmap this only sets up the mapping,
+/// pages are read on first touch. The mapping is private, so writing a tile
+/// copies that page instead of changing the file
+static void* map_file(const char* filename, size_t* size) {
+#if MAP_BIN_USE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t)st.st_size;
+    return data;
+#else
+    return SDL_LoadFile(filename, size);
+#endif
+}
+
+void map_release_file(void* data, size_t size) {
+#if MAP_BIN_USE_MMAP
+    munmap(data, size);
+#else
+    (void)size;
+    SDL_free(data);
+#endif
+}
+
+bool map_load_binary(Map* map, const char* filename) {
+    size_t size = 0;
+    uint8_t* data = (uint8_t*)map_file(filename, &size);
+    if (!data) {
+        printf("Error: Could not open map file %s\n", filename);
+        return false;
+    }
+
+    const MapBinHeader* header = (const MapBinHeader*)data;
+    if (!validate_header(header, size, filename)) {
+        map_release_file(data, size);
+        return false;
+    }
+
+    map->width = header->width;
+    map->height = header->height;
+    map->playerSpawn.x = header->player_spawn_x;
+    map->playerSpawn.y = header->player_spawn_y;
+    map->cost_config.floor_cost = header->floor_cost;
+    map->cost_config.wall_penalty = header->wall_penalty;
+
+    // The entity arrays are small next to the grids and the game appends to
+    // them, so they are copied out instead of used in place
+    map->enemies = (EnemyData*)calloc(header->enemy_count > 0 ? header->enemy_count : 1, sizeof(EnemyData));
+    map->enemy_spawns = (EnemySpawn*)calloc(header->enemy_spawn_count > 0 ? header->enemy_spawn_count : 1, sizeof(EnemySpawn));
+    map->npcs = (NPCData*)calloc(header->npc_count > 0 ? header->npc_count : 1, sizeof(NPCData));
+    if (!map->enemies || !map->enemy_spawns || !map->npcs) {
+        printf("Error: Could not allocate the entities of %s\n", filename);
+        free(map->enemies);
+        free(map->enemy_spawns);
+        free(map->npcs);
+        map->enemies = NULL;
+        map->enemy_spawns = NULL;
+        map->npcs = NULL;
+        map_release_file(data, size);
+        return false;
+    }
+    map->enemy_capacity = header->enemy_count;
+    map->enemy_spawn_capacity = header->enemy_spawn_count;
+    map->npc_capacity = header->npc_count;
+
+    const MapBinEnemy* enemies = (const MapBinEnemy*)(data + header->enemies_offset);
+    map->enemy_count = header->enemy_count;
+    for (int i = 0; i < map->enemy_count; i++) {
+        EnemyData* enemy = &map->enemies[i];
+        memcpy(enemy->id, enemies[i].id, sizeof(enemy->id));
+        enemy->id[sizeof(enemy->id) - 1] = '\0';
+        enemy->size = (Vector2f){ enemies[i].size_x, enemies[i].size_y };
+        enemy->sight_range = enemies[i].sight_range;
+        enemy->perception_radius = enemies[i].perception_radius;
+        enemy->attack_range = enemies[i].attack_range;
+        enemy->walking_speed = enemies[i].walking_speed;
+        enemy->stalking_speed = enemies[i].stalking_speed;
+        enemy->attacking_speed = enemies[i].attacking_speed;
+    }
+
+    // Spawns pointing at a missing definition are dropped
+    const MapBinEnemySpawn* spawns = (const MapBinEnemySpawn*)(data + header->enemy_spawns_offset);
+    map->enemy_spawn_count = 0;
+    for (int i = 0; i < header->enemy_spawn_count; i++) {
+        if (spawns[i].data < 0 || spawns[i].data >= map->enemy_count) continue;
+        EnemySpawn* spawn = &map->enemy_spawns[map->enemy_spawn_count++];
+        spawn->data = spawns[i].data;
+        spawn->pos.x = spawns[i].spawn_x;
+        spawn->pos.y = spawns[i].spawn_y;
+        map->enemies[spawn->data].spawn_count++;
+    }
+
+    const MapBinNpc* npcs = (const MapBinNpc*)(data + header->npcs_offset);
+    map->npc_count = header->npc_count;
+    for (int i = 0; i < map->npc_count; i++) {
+        NPCData* npc = &map->npcs[i];
+        memcpy(npc->id, npcs[i].id, sizeof(npc->id));
+        npc->id[sizeof(npc->id) - 1] = '\0';
+        npc->size = (Vector2f){ npcs[i].size_x, npcs[i].size_y };
+        npc->spawn_pos.x = npcs[i].spawn_x;
+        npc->spawn_pos.y = npcs[i].spawn_y;
+        npc->has_spawned = npcs[i].has_spawned != 0;
+        npc->dialogue_line_count = npcs[i].dialogue_line_count;
+        if (npc->dialogue_line_count < 0) npc->dialogue_line_count = 0;
+        if (npc->dialogue_line_count > MAX_DIALOGUE_LINES) npc->dialogue_line_count = MAX_DIALOGUE_LINES;
+        memcpy(npc->dialogue_lines, npcs[i].dialogue_lines, sizeof(npc->dialogue_lines));
+        for (int line = 0; line < MAX_DIALOGUE_LINES; line++) {
+            npc->dialogue_lines[line][MAX_DIALOGUE_LINE_LENGTH - 1] = '\0';
+        }
+    }
+
+    // The grids are used in place
+    map->tiles = data + header->tiles_offset;
+    map->wall_bits = (uint64_t*)(data + header->walls_offset);
+    map->cost_field = data + header->cost_offset;
+    map->file_data = data;
+    map->file_size = size;
+
+    printf("[MAP] Mapped %s (%dx%d)\n", filename, map->width, map->height);
+    return true;
+}
+
+static bool write_padding(FILE* file, uint64_t* written, uint64_t offset) {
+    static const uint8_t zeros[MAP_BIN_ALIGN] = { 0 };
+    while (*written < offset) {
+        size_t chunk = (size_t)(offset - *written);
+        if (chunk > sizeof(zeros)) chunk = sizeof(zeros);
+        if (fwrite(zeros, 1, chunk, file) != chunk) return false;
+        *written += chunk;
+    }
+    return true;
+}
+
+static bool write_section(FILE* file, uint64_t* written, uint64_t offset, const void* data, size_t size) {
+    if (!write_padding(file, written, offset)) return false;
+    if (size > 0 && fwrite(data, 1, size, file) != size) return false;
+    *written += size;
+    return true;
+}
+
+bool map_save_binary(const Map* map, const char* filename) {
+    if (!map->tiles || !map->wall_bits || !map->cost_field) {
+        printf("Error: Cannot save a map that is not loaded\n");
+        return false;
+    }
+
+    MapBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_BIN_MAGIC, sizeof(header.magic));
+    header.version = MAP_BIN_VERSION;
+    header.byte_order = MAP_BIN_BYTE_ORDER;
+    header.width = map->width;
+    header.height = map->height;
+    header.player_spawn_x = map->playerSpawn.x;
+    header.player_spawn_y = map->playerSpawn.y;
+    header.enemy_count = map->enemy_count;
+    header.enemy_spawn_count = map->enemy_spawn_count;
+    header.npc_count = map->npc_count;
+    header.floor_cost = map->cost_config.floor_cost;
+    header.wall_penalty = map->cost_config.wall_penalty;
+    header.file_size = layout_header(&header);
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        printf("Error: Could not create %s\n", filename);
+        return false;
+    }
+
+    uint64_t written = 0;
+    bool ok = write_section(file, &written, 0, &header, sizeof(header));
+
+    for (int i = 0; ok && i < map->enemy_count; i++) {
+        const EnemyData* enemy = &map->enemies[i];
+        MapBinEnemy record;
+        memset(&record, 0, sizeof(record));
+        memcpy(record.id, enemy->id, sizeof(record.id));
+        record.size_x = enemy->size.x;
+        record.size_y = enemy->size.y;
+        record.sight_range = enemy->sight_range;
+        record.perception_radius = enemy->perception_radius;
+        record.attack_range = enemy->attack_range;
+        record.walking_speed = enemy->walking_speed;
+        record.stalking_speed = enemy->stalking_speed;
+        record.attacking_speed = enemy->attacking_speed;
+        ok = write_section(file, &written, header.enemies_offset + i * sizeof(record), &record, sizeof(record));
+    }
+
+    for (int i = 0; ok && i < map->enemy_spawn_count; i++) {
+        const EnemySpawn* spawn = &map->enemy_spawns[i];
+        MapBinEnemySpawn record = { spawn->data, spawn->pos.x, spawn->pos.y };
+        ok = write_section(file, &written, header.enemy_spawns_offset + i * sizeof(record), &record, sizeof(record));
+    }
+
+    for (int i = 0; ok && i < map->npc_count; i++) {
+        const NPCData* npc = &map->npcs[i];
+        MapBinNpc record;
+        memset(&record, 0, sizeof(record));
+        memcpy(record.id, npc->id, sizeof(record.id));
+        record.size_x = npc->size.x;
+        record.size_y = npc->size.y;
+        record.spawn_x = npc->spawn_pos.x;
+        record.spawn_y = npc->spawn_pos.y;
+        record.has_spawned = npc->has_spawned;
+        record.dialogue_line_count = npc->dialogue_line_count;
+        memcpy(record.dialogue_lines, npc->dialogue_lines, sizeof(record.dialogue_lines));
+        ok = write_section(file, &written, header.npcs_offset + i * sizeof(record), &record, sizeof(record));
+    }
+
+    size_t tile_count = (size_t)map->width * map->height;
+    ok = ok && write_section(file, &written, header.tiles_offset, map->tiles, tile_count);
+    ok = ok && write_section(file, &written, header.walls_offset, map->wall_bits, ((tile_count + 63) / 64) * sizeof(uint64_t));
+    ok = ok && write_section(file, &written, header.cost_offset, map->cost_field, tile_count);
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        printf("Error: Could not write %s\n", filename);
+        remove(filename);
+    }
+    return ok;
+}
@@ -0,0 +1,97 @@
+// stalker-c/map/map_binary.h
+
+#ifndef MAP_BINARY_H
+#define MAP_BINARY_H
+
+/// Binary level format
+/// A level saved this way is laid out exactly the way the Map keeps it in
+/// memory, so loading it is a single mmap: the tile grid, wall bitset and cost
+/// field point straight into the mapping and nothing is parsed.
+///
+/// Layout (little endian, every section starts on a 64 byte boundary):
+///   MapBinHeader
+///   MapBinEnemy[enemy_count]
+///   MapBinEnemySpawn[enemy_spawn_count]
+///   MapBinNpc[npc_count]
+///   uint8_t  tiles[width * height]
+///   uint64_t wall_bits[(width * height + 63) / 64]
+///   uint8_t  cost_field[width * height]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "map.h"
+
+#define MAP_BIN_MAGIC "STLKLVL"   // 7 chars plus the terminator, 8 bytes
+#define MAP_BIN_VERSION 2
+#define MAP_BIN_BYTE_ORDER 0x01020304u
+#define MAP_BIN_ALIGN 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;     // Reads back as MAP_BIN_BYTE_ORDER on a matching machine
+    uint64_t file_size;
+    int32_t width;
+    int32_t height;
+    int32_t player_spawn_x;
+    int32_t player_spawn_y;
+    int32_t enemy_count;
+    int32_t enemy_spawn_count;
+    int32_t npc_count;
+    int32_t floor_cost;
+    int32_t wall_penalty;
+    int32_t reserved;        // Keeps the offsets 8 byte aligned, always 0
+    uint64_t enemies_offset;
+    uint64_t enemy_spawns_offset;
+    uint64_t npcs_offset;
+    uint64_t tiles_offset;
+    uint64_t walls_offset;
+    uint64_t cost_offset;
+} MapBinHeader;
+
+typedef struct {
+    char id[4];
+    float size_x;
+    float size_y;
+    float sight_range;
+    float perception_radius;
+    float attack_range;
+    float walking_speed;
+    float stalking_speed;
+    float attacking_speed;
+} MapBinEnemy;
+
+typedef struct {
+    int32_t data;            // Index of the MapBinEnemy it spawns
+    int32_t spawn_x;
+    int32_t spawn_y;
+} MapBinEnemySpawn;
+
+#define MAP_BIN_DIALOGUE_LINES 10
+#define MAP_BIN_DIALOGUE_LENGTH 128
+
+typedef struct {
+    char id[4];
+    float size_x;
+    float size_y;
+    int32_t spawn_x;
+    int32_t spawn_y;
+    int32_t has_spawned;
+    int32_t dialogue_line_count;
+    char dialogue_lines[MAP_BIN_DIALOGUE_LINES][MAP_BIN_DIALOGUE_LENGTH];
+} MapBinNpc;
+
+// True if the file starts with the binary magic
+bool map_file_is_binary(const char* filename);
+
+// Maps a binary level. The grids stay backed by the file mapping, which
+// map_destroy releases. Returns false and leaves the map empty on error
+bool map_load_binary(Map* map, const char* filename);
+
+// Unmaps (or frees) what map_load_binary mapped, called by map_destroy
+void map_release_file(void* data, size_t size);
+
+// Writes a loaded map (from either format) as a binary level
+bool map_save_binary(const Map* map, const char* filename);
+
+#endif // MAP_BINARY_H
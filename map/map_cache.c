@@ -0,0 +1,149 @@
+// stalker-c/map/map_cache.c
+
+#include "map_cache.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+MapRenderCache* map_cache_create(const Map* map, SDL_Renderer* renderer) {
+    MapRenderCache* cache = (MapRenderCache*)calloc(1, sizeof(MapRenderCache));
+    if (!cache) return NULL;
+
+    cache->renderer = renderer;
+    cache->chunks_x = (map->width + MAP_CHUNK_TILES - 1) / MAP_CHUNK_TILES;
+    cache->chunks_y = (map->height + MAP_CHUNK_TILES - 1) / MAP_CHUNK_TILES;
+    cache->slot_of_chunk = (int*)malloc((size_t)cache->chunks_x * cache->chunks_y * sizeof(int));
+    if (!cache->slot_of_chunk) {
+        free(cache);
+        return NULL;
+    }
+    for (int i = 0; i < cache->chunks_x * cache->chunks_y; i++) cache->slot_of_chunk[i] = -1;
+    for (int i = 0; i < MAP_CHUNK_CACHE_SIZE; i++) cache->slots[i].chunk = -1;
+
+    // One probe texture tells if render targets work at all
+    SDL_Texture* probe = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                           MAP_CHUNK_PIXELS, MAP_CHUNK_PIXELS);
+    if (!probe) {
+        printf("[MAP] Render targets unavailable, drawing tiles directly: %s\n", SDL_GetError());
+        map_cache_destroy(cache);
+        return NULL;
+    }
+    SDL_DestroyTexture(probe);
+    return cache;
+}
+
+void map_cache_destroy(MapRenderCache* cache) {
+    if (cache) {
+        for (int i = 0; i < MAP_CHUNK_CACHE_SIZE; i++) {
+            if (cache->slots[i].texture) SDL_DestroyTexture(cache->slots[i].texture);
+        }
+        free(cache->slot_of_chunk);
+        free(cache);
+    }
+}
+
+void map_cache_mark_dirty(MapRenderCache* cache, int tile_x, int tile_y) {
+    int chunk = (tile_y / MAP_CHUNK_TILES) * cache->chunks_x + tile_x / MAP_CHUNK_TILES;
+    int slot = cache->slot_of_chunk[chunk];
+    if (slot >= 0) cache->slots[slot].dirty = true;
+}
+
+// Picks a free slot or the one that was drawn the longest time ago. A slot used
+// this frame is never taken, its texture may still be queued for drawing
+static int acquire_slot(MapRenderCache* cache, int chunk) {
+    int best = -1;
+    for (int i = 0; i < MAP_CHUNK_CACHE_SIZE; i++) {
+        MapChunkSlot* slot = &cache->slots[i];
+        if (slot->chunk < 0) {
+            best = i;
+            break;
+        }
+        if (slot->last_used == cache->frame) continue;
+        if (best < 0 || slot->last_used < cache->slots[best].last_used) best = i;
+    }
+    if (best < 0) return -1;
+
+    MapChunkSlot* slot = &cache->slots[best];
+    if (slot->chunk >= 0) cache->slot_of_chunk[slot->chunk] = -1;
+    if (!slot->texture) {
+        slot->texture = SDL_CreateTexture(cache->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                          MAP_CHUNK_PIXELS, MAP_CHUNK_PIXELS);
+        if (!slot->texture) {
+            slot->chunk = -1;
+            return -1;
+        }
+        SDL_SetTextureBlendMode(slot->texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(slot->texture, SDL_SCALEMODE_NEAREST);
+    }
+    slot->chunk = chunk;
+    slot->dirty = true;
+    cache->slot_of_chunk[chunk] = best;
+    return best;
+}
+
+/// Draws the walls of one chunk into its texture, same look as the direct path
+static void redraw_chunk(MapRenderCache* cache, const Map* map, MapChunkSlot* slot) {
+    SDL_Renderer* renderer = cache->renderer;
+    SDL_Texture* previous_target = SDL_GetRenderTarget(renderer);
+
+    SDL_SetRenderTarget(renderer, slot->texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_TRANSPARENT);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(renderer, 100, 100, 100, SDL_ALPHA_OPAQUE);
+
+    int first_x = (slot->chunk % cache->chunks_x) * MAP_CHUNK_TILES;
+    int first_y = (slot->chunk / cache->chunks_x) * MAP_CHUNK_TILES;
+    for (int y = first_y; y < first_y + MAP_CHUNK_TILES && y < map->height; y++) {
+        for (int x = first_x; x < first_x + MAP_CHUNK_TILES && x < map->width; x++) {
+            if (map_is_wall(map, x, y)) {
+                SDL_FRect wall_rect = {
+                    .x = (float)(x - first_x) * TILE_SIZE,
+                    .y = (float)(y - first_y) * TILE_SIZE,
+                    .w = TILE_SIZE,
+                    .h = TILE_SIZE
+                };
+                SDL_RenderRect(renderer, &wall_rect);
+            }
+        }
+    }
+
+    SDL_SetRenderTarget(renderer, previous_target);
+    slot->dirty = false;
+    cache->rebuild_count++;
+}
+
+int map_cache_render(MapRenderCache* cache, const Map* map, const SDL_FRect* camera) {
+    cache->frame++;
+
+    int start_cx = (int)(camera->x / MAP_CHUNK_PIXELS);
+    int end_cx = (int)((camera->x + camera->w) / MAP_CHUNK_PIXELS);
+    int start_cy = (int)(camera->y / MAP_CHUNK_PIXELS);
+    int end_cy = (int)((camera->y + camera->h) / MAP_CHUNK_PIXELS);
+    if (start_cx < 0) start_cx = 0;
+    if (start_cy < 0) start_cy = 0;
+    if (end_cx >= cache->chunks_x) end_cx = cache->chunks_x - 1;
+    if (end_cy >= cache->chunks_y) end_cy = cache->chunks_y - 1;
+
+    int blits = 0;
+    for (int cy = start_cy; cy <= end_cy; cy++) {
+        for (int cx = start_cx; cx <= end_cx; cx++) {
+            int chunk = cy * cache->chunks_x + cx;
+            int index = cache->slot_of_chunk[chunk];
+            if (index < 0) index = acquire_slot(cache, chunk);
+            if (index < 0) continue;
+
+            MapChunkSlot* slot = &cache->slots[index];
+            if (slot->dirty) redraw_chunk(cache, map, slot);
+            slot->last_used = cache->frame;
+
+            SDL_FRect dest = {
+                .x = (float)cx * MAP_CHUNK_PIXELS - camera->x,
+                .y = (float)cy * MAP_CHUNK_PIXELS - camera->y,
+                .w = MAP_CHUNK_PIXELS,
+                .h = MAP_CHUNK_PIXELS
+            };
+            SDL_RenderTexture(cache->renderer, slot->texture, NULL, &dest);
+            blits++;
+        }
+    }
+    return blits;
+}
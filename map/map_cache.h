@@ -0,0 +1,52 @@
+// stalker-c/map/map_cache.h
+
+#ifndef MAP_CACHE_H
+#define MAP_CACHE_H
+
+/// Prerendered static tile layer
+/// The walls are drawn once into render target textures that cover
+/// MAP_CHUNK_TILES x MAP_CHUNK_TILES tiles each, so a frame blits the few
+/// chunks under the camera instead of issuing one draw per wall. Chunks are
+/// rendered the first time they come into view and again only when a tile in
+/// them changes. At most MAP_CHUNK_CACHE_SIZE of them are kept alive, the least
+/// recently drawn one is reused when that runs out, which keeps VRAM bounded on
+/// big levels.
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "map.h"
+
+#define MAP_CHUNK_TILES 32
+#define MAP_CHUNK_PIXELS (MAP_CHUNK_TILES * TILE_SIZE)
+#define MAP_CHUNK_CACHE_SIZE 64
+
+typedef struct {
+    SDL_Texture* texture;
+    int chunk;              // Chunk drawn into the texture, -1 if unused
+    bool dirty;             // A tile changed since it was drawn
+    uint64_t last_used;     // Frame it was last blitted
+} MapChunkSlot;
+
+typedef struct MapRenderCache {
+    SDL_Renderer* renderer;
+    int chunks_x;
+    int chunks_y;
+    int* slot_of_chunk;     // Per chunk, index into slots or -1
+    MapChunkSlot slots[MAP_CHUNK_CACHE_SIZE];
+    uint64_t frame;
+    int rebuild_count;      // Chunks drawn so far, for profiling
+} MapRenderCache;
+
+// Returns NULL when the renderer has no render target support, the caller
+// then draws the tiles directly
+MapRenderCache* map_cache_create(const Map* map, SDL_Renderer* renderer);
+void map_cache_destroy(MapRenderCache* cache);
+
+// Flags the chunk holding the tile for a redraw, map_set_tile calls it
+void map_cache_mark_dirty(MapRenderCache* cache, int tile_x, int tile_y);
+
+// Draws the chunks overlapping the camera, returns how many were blitted
+int map_cache_render(MapRenderCache* cache, const Map* map, const SDL_FRect* camera);
+
+#endif // MAP_CACHE_H
@@ -22,7 +22,9 @@ void npc_destroy(NPC* npc) {
     }
 }
 
-void npc_render(NPC* npc, SDL_Renderer* renderer, const Camera* camera) {
+void npc_render(NPC* npc, RenderBatch* batch, const Camera* camera) {
+    if (!render_batch_visible(batch, &npc->rect)) return;
+
     SDL_FRect render_rect = {
         .x = npc->rect.x - camera->x,
         .y = npc->rect.y - camera->y,
@@ -30,6 +32,5 @@ void npc_render(NPC* npc, SDL_Renderer* renderer, const Camera* camera) {
         .h = npc->rect.h
     };
 
-    SDL_SetRenderDrawColor(renderer, 0, 150, 255, SDL_ALPHA_OPAQUE);
-    SDL_RenderFillRect(renderer, &render_rect);
+    render_batch_fill_rect(batch, &render_rect, (SDL_Color){ 0, 150, 255, SDL_ALPHA_OPAQUE });
 }
@@ -3,6 +3,7 @@
 
 #include <SDL3/SDL.h>
 #include "../camera/camera.h"
+#include "../helper/render_batch.h"
 #include "../map/map.h"
 
 typedef struct {
@@ -13,7 +14,7 @@ typedef struct {
 } NPC;
 
 void npc_create(NPC* npc, const NPCData* data);
-void npc_render(NPC* npc, SDL_Renderer* renderer, const Camera* camera);
+void npc_render(NPC* npc, RenderBatch* batch, const Camera* camera);
 void npc_destroy(NPC* npc);
 
 #endif // NPC_H
@@ -11,6 +11,7 @@ void player_create(Player* player, Map *map) {
 
     player->rect.x = TILE_SIZE * map->playerSpawn.x;
     player->rect.y = TILE_SIZE * map->playerSpawn.y;
+    player->previous_rect = player->rect;
 
     player->vel.x = 0.0f;
     player->vel.y = 0.0f;
@@ -18,15 +19,17 @@ void player_create(Player* player, Map *map) {
     player->noise = PLAYER_IDLE_NOISE;
 }
 
-void player_render(Player* player, SDL_Renderer* renderer, const Camera *camera) {
+void player_render(Player* player, RenderBatch* batch, const Camera *camera, float alpha) {
+    SDL_FRect world_rect = render_lerp_rect(&player->previous_rect, &player->rect, alpha);
+    if (!render_batch_visible(batch, &world_rect)) return;
+
     SDL_FRect render_rect = {
-        .x = player->rect.x - camera->x,
-        .y = player->rect.y - camera->y,
-        .w = player->rect.w,
-        .h = player->rect.h
+        .x = world_rect.x - camera->x,
+        .y = world_rect.y - camera->y,
+        .w = world_rect.w,
+        .h = world_rect.h
     };
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-    SDL_RenderRect(renderer, &render_rect);
+    render_batch_rect(batch, &render_rect, (SDL_Color){ 255, 255, 255, SDL_ALPHA_OPAQUE });
 }
 
 static void player_handle_map_collision(Player* player, const Map* map) {
@@ -65,7 +68,7 @@ static void player_handle_map_collision(Player* player, const Map* map) {
     grid_y_top = (player->rect.y) / TILE_SIZE;
     grid_y_bottom = (player->rect.y + player->rect.h) / TILE_SIZE;
 
-    if (map->tiles[grid_y_top][grid_x] == 1 || map->tiles[grid_y_bottom][grid_x] == 1) {
+    if (map_is_wall(map, grid_x, grid_y_top) || map_is_wall(map, grid_x, grid_y_bottom)) {
         player->vel.x = 0;
     }
 
@@ -81,7 +84,7 @@ static void player_handle_map_collision(Player* player, const Map* map) {
     grid_x_left = (player->rect.x) / TILE_SIZE;
         grid_x_right = (player->rect.x + player->rect.w) / TILE_SIZE;
 
-    if (map->tiles[grid_y][grid_x_left] == 1 || map->tiles[grid_y][grid_x_right] == 1) {
+    if (map_is_wall(map, grid_x_left, grid_y) || map_is_wall(map, grid_x_right, grid_y)) {
         player->vel.y = 0;
     }
 }
@@ -106,7 +109,8 @@ void player_update(Player* player, const bool* keyboard_state, const Map* map) {
         player->noise = PLAYER_IDLE_NOISE;
     }
     float current_speed = sqrtf(player->vel.x * player->vel.x + player->vel.y * player->vel.y);
-    float max_speed;
+    // Without input the player only slows down, the running cap never kicks in
+    float max_speed = MAX_PLAYER_RUNNING_SPEED;
     if (is_running && player->stamina > 0 && (input_x != 0 || input_y != 0)) {
         max_speed = MAX_PLAYER_RUNNING_SPEED;
         player->noise = PLAYER_RUNNING_NOISE;
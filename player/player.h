@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include "../map/map.h"
 #include "../camera/camera.h"
+#include "../helper/render_batch.h"
 
 /// Player Physics
 /// The player physics is extensive, and very different from the enemy physics
@@ -31,6 +32,7 @@
 /// Main player struct, everything player related needs to be here
 typedef struct player {
     SDL_FRect rect;
+    SDL_FRect previous_rect; // rect at the start of the last tick, for interpolation
     Vector2f vel;
     uint8_t stamina;
     float noise;
@@ -41,6 +43,7 @@ void player_create(Player* player, Map *map);
 /// Updates the player movement, noise, collision...
 void player_update(Player* player, const bool* keyboard_state, const Map *map);
 /// Renders the player, soon I'll add textures
-void player_render(Player* player, SDL_Renderer* renderer, const Camera *camera);
+/// alpha is how far the frame is between the previous tick and the current one
+void player_render(Player* player, RenderBatch* batch, const Camera *camera, float alpha);
 
 #endif // PLAYER_H
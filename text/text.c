@@ -1,10 +1,103 @@
 #include "text.h"
 #include <SDL3/SDL_error.h>
 #include <stdio.h>
+#include <string.h>
+#include "../helper/profiler.h"
+
+// Glyphs for printable ASCII are rasterized once into a single atlas texture
+// in text_init. Drawing text is then one SDL_RenderGeometry call per string,
+// with no rasterization and no texture allocation per frame
+#define TEXT_FIRST_GLYPH 32
+#define TEXT_LAST_GLYPH 126
+#define TEXT_GLYPH_COUNT (TEXT_LAST_GLYPH - TEXT_FIRST_GLYPH + 1)
+#define TEXT_ATLAS_COLUMNS 16
+#define TEXT_ATLAS_PADDING 4   // Keeps linear filtering from bleeding between glyphs
+#define TEXT_MAX_QUADS 128     // Longer strings are sent in several calls
+
+// The font is rasterized at 4x the size it is shown at
+static const float scale = 4.0f;
+
+typedef struct {
+    SDL_FRect source;   // Cell in the atlas, in atlas pixels
+    float advance;      // Pen advance, in font pixels
+} Glyph;
 
 static TTF_Font* font = NULL;
+static SDL_Texture* atlas = NULL;
+static float atlas_width = 0;
+static float atlas_height = 0;
+static float line_height = 0;
+static Glyph glyphs[TEXT_GLYPH_COUNT];
+
+static SDL_Vertex vertices[TEXT_MAX_QUADS * 4];
+static int indices[TEXT_MAX_QUADS * 6];
+
+static void build_atlas(SDL_Renderer* renderer) {
+    const SDL_Color white = { 255, 255, 255, 255 };
+    SDL_Surface* rendered[TEXT_GLYPH_COUNT] = { NULL };
+    int cell_width = 1;
+    int cell_height = TTF_GetFontHeight(font);
+
+    for (int i = 0; i < TEXT_GLYPH_COUNT; i++) {
+        int advance = 0;
+        TTF_GetGlyphMetrics(font, TEXT_FIRST_GLYPH + i, NULL, NULL, NULL, NULL, &advance);
+        glyphs[i].advance = (float)advance;
+        rendered[i] = TTF_RenderGlyph_Solid(font, TEXT_FIRST_GLYPH + i, white);
+        if (rendered[i]) {
+            if (rendered[i]->w > cell_width) cell_width = rendered[i]->w;
+            if (rendered[i]->h > cell_height) cell_height = rendered[i]->h;
+        }
+    }
+
+    int rows = (TEXT_GLYPH_COUNT + TEXT_ATLAS_COLUMNS - 1) / TEXT_ATLAS_COLUMNS;
+    int stride_x = cell_width + TEXT_ATLAS_PADDING;
+    int stride_y = cell_height + TEXT_ATLAS_PADDING;
+    SDL_Surface* sheet = SDL_CreateSurface(TEXT_ATLAS_COLUMNS * stride_x, rows * stride_y, SDL_PIXELFORMAT_RGBA32);
+
+    if (sheet) {
+        // Solid glyphs are colour keyed, blitting them over a transparent
+        // sheet leaves white glyphs on alpha 0
+        SDL_FillSurfaceRect(sheet, NULL, 0);
+        for (int i = 0; i < TEXT_GLYPH_COUNT; i++) {
+            int x = (i % TEXT_ATLAS_COLUMNS) * stride_x;
+            int y = (i / TEXT_ATLAS_COLUMNS) * stride_y;
+            int w = rendered[i] ? rendered[i]->w : 0;
+            int h = rendered[i] ? rendered[i]->h : 0;
+            if (rendered[i]) {
+                SDL_Rect dest = { x, y, w, h };
+                SDL_BlitSurface(rendered[i], NULL, sheet, &dest);
+            }
+            glyphs[i].source = (SDL_FRect){ (float)x, (float)y, (float)w, (float)h };
+        }
+
+        atlas = SDL_CreateTextureFromSurface(renderer, sheet);
+        if (atlas) {
+            SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+            atlas_width = (float)sheet->w;
+            atlas_height = (float)sheet->h;
+        } else {
+            printf("Failed to create the glyph atlas: %s\n", SDL_GetError());
+        }
+        SDL_DestroySurface(sheet);
+    }
 
-void text_init() {
+    for (int i = 0; i < TEXT_GLYPH_COUNT; i++) {
+        SDL_DestroySurface(rendered[i]);
+    }
+    line_height = (float)cell_height;
+
+    // The index pattern never changes, two triangles per quad
+    for (int q = 0; q < TEXT_MAX_QUADS; q++) {
+        indices[q * 6 + 0] = q * 4 + 0;
+        indices[q * 6 + 1] = q * 4 + 1;
+        indices[q * 6 + 2] = q * 4 + 2;
+        indices[q * 6 + 3] = q * 4 + 1;
+        indices[q * 6 + 4] = q * 4 + 3;
+        indices[q * 6 + 5] = q * 4 + 2;
+    }
+}
+
+void text_init(SDL_Renderer* renderer) {
     if (!TTF_Init()) {
         printf("Failed to initialize SDL_ttf\n");
         return;
@@ -13,63 +106,173 @@ void text_init() {
     font = TTF_OpenFont("res/PublicPixel.ttf", 8*4); // Load font at size 16
     if (!font) {
         printf("Failed to load font\n");
+        return;
     }
+    build_atlas(renderer);
 }
 
-void text_render(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color) {
-    if (font == NULL) return;
+static const Glyph* glyph_for(char c) {
+    unsigned char code = (unsigned char)c;
+    if (code < TEXT_FIRST_GLYPH || code > TEXT_LAST_GLYPH) code = '?';
+    return &glyphs[code - TEXT_FIRST_GLYPH];
+}
 
-    SDL_Surface* surface = TTF_RenderText_Solid(font, text,0, color);
-    if (surface == NULL) {
-        printf("Failed to render text surface: %s\n", SDL_GetError());
-        return;
-    }
+// Fills the four vertices of one glyph with its top left corner at (x, y)
+static void write_quad(SDL_Vertex* v, const Glyph* glyph, float x, float y, SDL_FColor color) {
+    float w = glyph->source.w / scale;
+    float h = glyph->source.h / scale;
+    float u0 = glyph->source.x / atlas_width;
+    float v0 = glyph->source.y / atlas_height;
+    float u1 = (glyph->source.x + glyph->source.w) / atlas_width;
+    float v1 = (glyph->source.y + glyph->source.h) / atlas_height;
 
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (texture == NULL) {
-        printf("Failed to create texture from surface: %s\n", SDL_GetError());
-        SDL_DestroySurface(surface);
-        return;
+    v[0] = (SDL_Vertex){ { x, y }, color, { u0, v0 } };
+    v[1] = (SDL_Vertex){ { x, y + h }, color, { u0, v1 } };
+    v[2] = (SDL_Vertex){ { x + w, y }, color, { u1, v0 } };
+    v[3] = (SDL_Vertex){ { x + w, y + h }, color, { u1, v1 } };
+}
+
+/// Queues the quads for text[0..length) with its pen starting at (x, y),
+/// positions are in screen pixels. Sends a full buffer as it goes
+static int emit_run(SDL_Renderer* renderer, const char* text, int length, float x, float y, SDL_FColor color, int quads) {
+    for (int i = 0; i < length; i++) {
+        const Glyph* glyph = glyph_for(text[i]);
+        if (glyph->source.w > 0 && text[i] != ' ') {
+            if (quads == TEXT_MAX_QUADS) {
+                SDL_RenderGeometry(renderer, atlas, vertices, quads * 4, indices, quads * 6);
+                quads = 0;
+            }
+            write_quad(&vertices[quads * 4], glyph, x, y, color);
+            quads++;
+        }
+        x += glyph->advance / scale;
     }
+    return quads;
+}
+
+static SDL_FColor to_fcolor(SDL_Color color) {
+    return (SDL_FColor){ color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f };
+}
 
-    const float scale = 4.0f;
+void text_render(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color) {
+    if (atlas == NULL) return;
 
-    SDL_FRect dest_rect = { x, y, surface->w/scale, surface->h/scale };
+    PROFILE_BEGIN(PROFILE_ZONE_TEXT);
+    int quads = emit_run(renderer, text, (int)strlen(text), (float)x, (float)y, to_fcolor(color), 0);
+    if (quads > 0) SDL_RenderGeometry(renderer, atlas, vertices, quads * 4, indices, quads * 6);
+    PROFILE_END(PROFILE_ZONE_TEXT);
+}
 
-    SDL_RenderTexture(renderer, texture, NULL, &dest_rect);
+/// Finds where the line starting at text ends when wrapped at wrap_length (in
+/// font pixels, the unit TTF_RenderText_Solid_Wrapped used). Returns how many
+/// characters to skip to reach the next line
+static int wrap_next_line(const char* text, int wrap_length, int* line_length) {
+    // Breaks after the last space that still fits, a word longer than the
+    // whole line is cut where it overflows
+    int end = 0;
+    int last_break = -1;
+    float width = 0;
+    while (text[end] != '\0' && text[end] != '\n') {
+        float advance = glyph_for(text[end])->advance;
+        if (width + advance > wrap_length && end > 0) {
+            if (text[end] == ' ') {
+                last_break = end;
+            }
+            break;
+        }
+        if (text[end] == ' ') last_break = end;
+        width += advance;
+        end++;
+    }
 
-    // Clean up
-    SDL_DestroyTexture(texture);
-    SDL_DestroySurface(surface);
+    if (text[end] == '\0' || text[end] == '\n') {
+        *line_length = end;
+        return text[end] == '\n' ? end + 1 : end;
+    }
+    if (last_break > 0) {
+        *line_length = last_break;
+        int next = last_break;
+        while (text[next] == ' ') next++;
+        return next;
+    }
+    *line_length = end;
+    return end;
 }
 
 void text_render_wrapped(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color, int wrap_length) {
-    if (font == NULL) return;
+    if (atlas == NULL) return;
 
-    SDL_Surface* surface = TTF_RenderText_Solid_Wrapped(font, text, 0, color, wrap_length);
-    if (surface == NULL) {
-        printf("Failed to render wrapped text surface: %s\n", SDL_GetError());
-        return;
+    PROFILE_BEGIN(PROFILE_ZONE_TEXT);
+    SDL_FColor fcolor = to_fcolor(color);
+    float pen_y = (float)y;
+    int quads = 0;
+    while (*text != '\0') {
+        int line_length = 0;
+        int consumed = wrap_next_line(text, wrap_length, &line_length);
+        quads = emit_run(renderer, text, line_length, (float)x, pen_y, fcolor, quads);
+        pen_y += line_height / scale;
+        text += consumed;
+        if (consumed == 0) break;
     }
+    if (quads > 0) SDL_RenderGeometry(renderer, atlas, vertices, quads * 4, indices, quads * 6);
+    PROFILE_END(PROFILE_ZONE_TEXT);
+}
 
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (texture == NULL) {
-        printf("Failed to create texture from surface: %s\n", SDL_GetError());
-        SDL_DestroySurface(surface);
-        return;
-    }
+void text_layout_wrapped(TextLayout* layout, const char* text, int x, int y, SDL_Color color, int wrap_length) {
+    layout->char_count = 0;
+    layout->quads_before[0] = 0;
+    if (atlas == NULL) return;
 
-    const float scale = 4.0f;
-    // We scale the final rectangle just like before.
-    SDL_FRect dest_rect = { x, y, surface->w / scale, surface->h / scale };
+    SDL_FColor fcolor = to_fcolor(color);
+    int length = (int)strlen(text);
+    if (length > TEXT_LAYOUT_MAX_CHARS) length = TEXT_LAYOUT_MAX_CHARS;
 
-    SDL_RenderTexture(renderer, texture, NULL, &dest_rect);
+    // Same line breaking as text_render_wrapped, but every character records
+    // how many quads exist once it is shown. Spaces and breaks add none
+    int quads = 0;
+    int index = 0;
+    float pen_y = (float)y;
+    while (index < length) {
+        int line_length = 0;
+        int consumed = wrap_next_line(text + index, wrap_length, &line_length);
+        if (consumed == 0) break;
 
-    SDL_DestroyTexture(texture);
-    SDL_DestroySurface(surface);
+        float pen_x = (float)x;
+        for (int i = 0; i < consumed && index + i < length; i++) {
+            char c = text[index + i];
+            const Glyph* glyph = glyph_for(c);
+            if (i < line_length && c != ' ' && glyph->source.w > 0) {
+                write_quad(&layout->vertices[quads * 4], glyph, pen_x, pen_y, fcolor);
+                quads++;
+            }
+            if (i < line_length) pen_x += glyph->advance / scale;
+            layout->quads_before[index + i + 1] = quads;
+        }
+        index += consumed;
+        pen_y += line_height / scale;
+    }
+    layout->char_count = length;
+}
+
+void text_render_layout(SDL_Renderer* renderer, const TextLayout* layout, int visible_chars) {
+    if (atlas == NULL || visible_chars <= 0) return;
+    if (visible_chars > layout->char_count) visible_chars = layout->char_count;
+
+    // The shared index buffer covers TEXT_MAX_QUADS quads, longer layouts go
+    // out in slices of that size
+    PROFILE_BEGIN(PROFILE_ZONE_TEXT);
+    int quads = layout->quads_before[visible_chars];
+    for (int first = 0; first < quads; first += TEXT_MAX_QUADS) {
+        int count = quads - first < TEXT_MAX_QUADS ? quads - first : TEXT_MAX_QUADS;
+        SDL_RenderGeometry(renderer, atlas, &layout->vertices[first * 4], count * 4, indices, count * 6);
+    }
+    PROFILE_END(PROFILE_ZONE_TEXT);
 }
 
 void text_quit() {
+    if (atlas) SDL_DestroyTexture(atlas);
+    atlas = NULL;
     TTF_CloseFont(font);
+    font = NULL;
     TTF_Quit();
 }
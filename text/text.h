@@ -4,9 +4,25 @@
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
 
-void text_init();
+// Needs the renderer to upload the glyph atlas
+void text_init(SDL_Renderer* renderer);
 void text_render(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color);
 void text_render_wrapped(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color, int wrap_length);
+/// A string laid out once and drawn many times. Drawing a prefix of its
+/// characters costs the same as drawing the whole thing, nothing is redone
+#define TEXT_LAYOUT_MAX_CHARS 256
+
+typedef struct {
+    SDL_Vertex vertices[TEXT_LAYOUT_MAX_CHARS * 4];
+    int quads_before[TEXT_LAYOUT_MAX_CHARS + 1]; // Quads used by the first n characters
+    int char_count;
+} TextLayout;
+
+// Lays out text the same way text_render_wrapped draws it
+void text_layout_wrapped(TextLayout* layout, const char* text, int x, int y, SDL_Color color, int wrap_length);
+// Draws the glyphs of the first visible_chars characters of the layout
+void text_render_layout(SDL_Renderer* renderer, const TextLayout* layout, int visible_chars);
+
 void text_quit();
 
 #endif // TEXT_H
@@ -0,0 +1,54 @@
+// stalker-c/tools/level_convert.c
+// Converts a text level (level.txt) into the binary format of map/map_binary.h
+//
+// Build (from the repository root):
+//   cc -O2 -o level_convert tools/level_convert.c map/*.c
+//      helper/vector.c helper/rng.c helper/profiler.c helper/trace.c $(pkg-config --cflags --libs sdl3) -lm
+// Usage:
+//   ./level_convert level.txt level.bin
+
+#include <stdio.h>
+#include <string.h>
+#include "../map/map.h"
+#include "../map/map_binary.h"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        printf("Usage: %s <level.txt> <level.bin>\n", argv[0]);
+        return 1;
+    }
+
+    Map map;
+    memset(&map, 0, sizeof(map));
+    map_load_from_file(&map, argv[1]);
+    if (!map.tiles || !map.cost_field) {
+        printf("Error: Could not load %s\n", argv[1]);
+        map_destroy(&map);
+        return 1;
+    }
+
+    if (!map_save_binary(&map, argv[2])) {
+        map_destroy(&map);
+        return 1;
+    }
+
+    // Reads the result back so a broken file is caught here and not in game
+    Map check;
+    memset(&check, 0, sizeof(check));
+    bool same = map_load_binary(&check, argv[2])
+        && check.width == map.width && check.height == map.height
+        && check.enemy_count == map.enemy_count && check.npc_count == map.npc_count
+        && check.enemy_spawn_count == map.enemy_spawn_count
+        && memcmp(check.tiles, map.tiles, (size_t)map.width * map.height) == 0
+        && memcmp(check.cost_field, map.cost_field, (size_t)map.width * map.height) == 0;
+    if (!same) {
+        printf("Error: %s does not read back the same as %s\n", argv[2], argv[1]);
+    } else {
+        printf("Converted %s -> %s (%dx%d, %d enemies of %d types, %d npcs)\n",
+               argv[1], argv[2], map.width, map.height, map.enemy_spawn_count, map.enemy_count, map.npc_count);
+    }
+
+    map_destroy(&check);
+    map_destroy(&map);
+    return same ? 0 : 1;
+}